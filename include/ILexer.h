@@ -18,7 +18,7 @@ namespace Scintilla {
 	#define SCI_METHOD
 #endif
 
-enum { dvOriginal=0, dvLineEnd=1 };
+enum { dvOriginal=0, dvLineEnd=1, dvSegments=2, dvStyleRuns=3 };
 
 class IDocument {
 public:
@@ -52,6 +52,22 @@ public:
 	virtual int SCI_METHOD GetCharacterAndWidth(int position, int *pWidth) const = 0;
 };
 
+class IDocumentWithSegments : public IDocumentWithLineEnd {
+public:
+	// Retrieve read-only pointers to the contiguous part of the text or styles that contains
+	// position without moving any data. The pointer is to the byte at *segmentStart and the
+	// segment extends to *segmentEnd. Pointers remain valid until the text is next modified.
+	virtual const char * SCI_METHOD SegmentPointer(int position, int *segmentStart, int *segmentEnd) const = 0;
+	virtual const char * SCI_METHOD StyleSegmentPointer(int position, int *segmentStart, int *segmentEnd) const = 0;
+};
+
+class IDocumentWithStyleRuns : public IDocumentWithSegments {
+public:
+	// Set the styles of runs consecutive characters from the styling position with
+	// lengths[i] characters set to styles[i].
+	virtual bool SCI_METHOD SetStyleRuns(int runs, const int *lengths, const char *styles) = 0;
+};
+
 enum { lvOriginal=0, lvSubStyles=1 };
 
 class ILexer {
@@ -83,6 +99,22 @@ public:
 	virtual const char * SCI_METHOD GetSubStyleBases() = 0;
 };
 
+// Operations for ILexer::PrivateCall that are understood by Scintilla itself so lexers
+// should not use these values for their own operations.
+enum { pcRestarts=0x52535452 };
+
+// Returned by PrivateCall(pcRestarts, 0) from lexers whose state is reset at the start of some lines.
+// A line is a restart point when the line before it ended in a style and line state for which
+// IsRestart is true. Lexing from a restart point with initStyle RestartStyle() must then give the
+// same result as continuing from the previous line without reading any text, styles or line states
+// before the restart point. Such lexers must also allow Lex to be called concurrently from several
+// threads for different ranges on different IDocument objects.
+class ILexerRestarts {
+public:
+	virtual int SCI_METHOD RestartStyle() = 0;
+	virtual bool SCI_METHOD IsRestart(int style, int lineState) = 0;
+};
+
 class ILoader {
 public:
 	virtual int SCI_METHOD Release() = 0;
@@ -89,6 +89,8 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SETSTYLING 2033
 #define SCI_GETBUFFEREDDRAW 2034
 #define SCI_SETBUFFEREDDRAW 2035
+#define SCI_GETRETAINEDDRAW 2675
+#define SCI_SETRETAINEDDRAW 2674
 #define SCI_SETTABWIDTH 2036
 #define SCI_GETTABWIDTH 2121
 #define SC_CP_UTF8 65001
@@ -147,6 +149,8 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_MARKERPREVIOUS 2048
 #define SCI_MARKERDEFINEPIXMAP 2049
 #define SCI_MARKERADDSET 2466
+#define SCI_MARKERADDMANY 2680
+#define SCI_MARKERDELETEMANY 2681
 #define SCI_MARKERSETALPHA 2476
 #define SC_MAX_MARGIN 4
 #define SC_MARGIN_SYMBOL 0
@@ -438,6 +442,8 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_HIDELINES 2227
 #define SCI_GETLINEVISIBLE 2228
 #define SCI_GETALLLINESVISIBLE 2236
+#define SCI_SETLINEFILTER 2683
+#define SCI_GETLINEFILTER 2684
 #define SCI_SETFOLDEXPANDED 2229
 #define SCI_GETFOLDEXPANDED 2230
 #define SCI_TOGGLEFOLD 2231
@@ -499,6 +505,13 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SC_CACHE_DOCUMENT 3
 #define SCI_SETLAYOUTCACHE 2272
 #define SCI_GETLAYOUTCACHE 2273
+#define SCI_SETLAYOUTCACHEMEMORY 2671
+#define SCI_GETLAYOUTCACHEMEMORY 2672
+#define SCI_GETLAYOUTCACHEMEMORYUSED 2673
+#define SCI_SETLAYOUTPREFETCH 2676
+#define SCI_GETLAYOUTPREFETCH 2677
+#define SCI_SETLONGLINETHRESHOLD 2678
+#define SCI_GETLONGLINETHRESHOLD 2679
 #define SCI_SETSCROLLWIDTH 2274
 #define SCI_GETSCROLLWIDTH 2275
 #define SCI_SETSCROLLWIDTHTRACKING 2516
@@ -747,6 +760,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_GETINDICATORVALUE 2503
 #define SCI_INDICATORFILLRANGE 2504
 #define SCI_INDICATORCLEARRANGE 2505
+#define SCI_INDICATORFILLRANGES 2682
 #define SCI_INDICATORALLONFOR 2506
 #define SCI_INDICATORVALUEAT 2507
 #define SCI_INDICATORSTART 2508
@@ -782,6 +796,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_SETMARGINOPTIONS 2539
 #define SCI_GETMARGINOPTIONS 2557
 #define SCI_ANNOTATIONSETTEXT 2540
+#define SCI_ANNOTATIONSETTEXTMANY 2685
 #define SCI_ANNOTATIONGETTEXT 2541
 #define SCI_ANNOTATIONSETSTYLE 2542
 #define SCI_ANNOTATIONGETSTYLE 2543
@@ -19,6 +19,7 @@
 #include "Accessor.h"
 #include "StyleContext.h"
 #include "CharacterSet.h"
+#include "StyleRuns.h"
 #include "LexerModule.h"
 
 #ifdef SCI_NAMESPACE
@@ -393,39 +394,33 @@ static void FoldE8Doc(unsigned int startPos, int length, int initStyle,
 {
 
 	bool foldComment = styler.GetPropertyInt("fold.comment") != 0;
-	bool foldPreprocessor = styler.GetPropertyInt("fold.preprocessor") != 0;
-	bool foldCompact = styler.GetPropertyInt("fold.compact", 1) != 0;
-	unsigned int endPos = startPos + length;
-	int visibleChars = 0;
 	int lineCurrent = styler.GetLine(startPos);
 	int levelPrev = styler.LevelAt(lineCurrent) & SC_FOLDLEVELNUMBERMASK;
 	int levelCurrent = levelPrev;
 	int lineFoldStateCurrent = lineCurrent > 0 ? styler.GetLineState(lineCurrent - 1) & stateFoldMaskAll : 0;
-	char chNext = styler[startPos];
-	int styleNext = styler.StyleAt(startPos);
-	int style = initStyle;
 
 	int lastStart = 0;
 	
 	bool foldDoc = foldComment;
 	
-	for (unsigned int i = startPos; i < endPos; i++) {
-		char ch = chNext;
-		chNext = styler.SafeGetCharAt(i + 1);
-		int stylePrev = style;
-		style = styleNext;
-		styleNext = styler.StyleAt(i + 1);
-		bool atEOL = (ch == '\r' && chNext != '\n') || (ch == '\n');
+	// Only the first and last characters of each run and the ends of lines can change the level.
+	for (StyleRuns run(startPos, length, initStyle, styler); run.More(); run.Forward()) {
+		const int style = run.Style();
+		const int last = run.End() - 1;
+		// The last character ends a styled section when it does not also start it
+		const bool endsStyle = run.EndsStyle() && !run.AtLineEnd() &&
+			!(run.StartsStyle() && (run.End() - run.Start() == 1));
 
 		if (foldComment && IsStreamCommentStyle(style)) {
-			if (!IsStreamCommentStyle(stylePrev)) {
+			if (run.StartsStyle()) {
 				levelCurrent++;
-			} else if (!IsStreamCommentStyle(styleNext) && !atEOL) {
+			}
+			if (endsStyle) {
 				// Comments don't end at end of line and the next character may be unstyled.
 				levelCurrent--;
 			}
 		}
-		if (foldComment && atEOL && IsCommentLine(lineCurrent, styler))
+		if (foldComment && run.AtLineEnd() && IsCommentLine(lineCurrent, styler))
 		{
 			if (!IsCommentLine(lineCurrent - 1, styler)
 			    && IsCommentLine(lineCurrent + 1, styler))
@@ -435,14 +430,15 @@ static void FoldE8Doc(unsigned int startPos, int length, int initStyle,
 				levelCurrent--;
 		}
 		if (foldDoc && IsStreamDocStyle(style)) {
-			if (!IsStreamDocStyle(stylePrev)) {
+			if (run.StartsStyle()) {
 				levelCurrent++;
-			} else if (!IsStreamDocStyle(styleNext) && !atEOL) {
+			}
+			if (endsStyle) {
 				// Comments don't end at end of line and the next character may be unstyled.
 				levelCurrent--;
 			}
 		}
-		if (foldDoc && atEOL && IsDocLine(lineCurrent, styler))
+		if (foldDoc && run.AtLineEnd() && IsDocLine(lineCurrent, styler))
 		{
 			if (!IsDocLine(lineCurrent - 1, styler)
 			    && IsDocLine(lineCurrent + 1, styler))
@@ -452,29 +448,20 @@ static void FoldE8Doc(unsigned int startPos, int length, int initStyle,
 				levelCurrent--;
 		}
 		
-		if (stylePrev != SCE_E8_KEYWORD && style == SCE_E8_KEYWORD)
-		{
-			// Store last word start point.
-			lastStart = i;
-		}
-		if (stylePrev == SCE_E8_KEYWORD && !(lineFoldStateCurrent & stateFoldInPreprocessor)) {
-			//if(setWord.Contains(ch) && !setWord.Contains(chNext)) {
-			//if (IsAWordChar(ch) && !IsAWordChar(chNext)) {
-			if (style == SCE_E8_KEYWORD && styleNext != SCE_E8_KEYWORD) {
-				ClassifyE8WordFoldPoint(levelCurrent, lineFoldStateCurrent, startPos, endPos, lastStart, i, styler);
+		if (style == SCE_E8_KEYWORD) {
+			if (run.StartsStyle()) {
+				// Store last word start point.
+				lastStart = run.Start();
+			}
+			if (run.EndsStyle() && ((last > run.Start()) || !run.StartsStyle())
+				&& !(lineFoldStateCurrent & stateFoldInPreprocessor)) {
+				ClassifyE8WordFoldPoint(levelCurrent, lineFoldStateCurrent, startPos, startPos + length, lastStart, last, styler);
 			}
 		}
-		
-		if (!IsASpace(ch))
-			visibleChars++;
 
-		if (atEOL) {
+		if (run.AtLineEnd()) {
 			int lev = levelPrev;
-			/*
-			if (visibleChars == 0 && foldCompact)
-				lev |= SC_FOLDLEVELWHITEFLAG;
-			*/
-			if ((levelCurrent > levelPrev) && (visibleChars > 0))
+			if ((levelCurrent > levelPrev) && run.LineVisible())
 				lev |= SC_FOLDLEVELHEADERFLAG;
 			if (lev != styler.LevelAt(lineCurrent)) {
 				styler.SetLevel(lineCurrent, lev);
@@ -483,22 +470,27 @@ static void FoldE8Doc(unsigned int startPos, int length, int initStyle,
 			styler.SetLineState(lineCurrent, newLineState);
 			lineCurrent++;
 			levelPrev = levelCurrent;
-			visibleChars = 0;
 		}
 	}
 
 	// If we didn't reach the EOL in previous loop, store line level and whitespace information.
 	// The rest will be filled in later...
-	int lev = levelPrev;
-	/*
-	if (visibleChars == 0 && foldCompact)
-		lev |= SC_FOLDLEVELWHITEFLAG;
-	*/
-	styler.SetLevel(lineCurrent, lev);
+	styler.SetLevel(lineCurrent, levelPrev);
 	
 }
 
 
+// Styles that ColouriseE8Doc resets to SCE_E8_DEFAULT at the start of a line.
+// Only multi-line comments continue onto the next line.
+static bool IsE8Restart(int style, int) {
+	return style == SCE_E8_DEFAULT
+		|| style == SCE_E8_STRINGEOL
+		|| style == SCE_E8_COMMENT
+		|| style == SCE_E8_DOC
+		|| style == SCE_E8_PREPROCESSOR
+		|| style == SCE_E8_DATE;
+}
+
 static const char * const e8WordListDesc[] = {
 	"Keywords",
 	"user1",
@@ -507,6 +499,7 @@ static const char * const e8WordListDesc[] = {
 	0
 };
 
-LexerModule lmE8Script(SCLEX_E8Script, ColouriseE8Doc, "e8s", FoldE8Doc, e8WordListDesc);
+LexerModule lmE8Script(SCLEX_E8Script, ColouriseE8Doc, "e8s", FoldE8Doc, e8WordListDesc, 5,
+	SCE_E8_DEFAULT, IsE8Restart);
 
 #undef E8_MAX_IDENTIFIER_SIZE_BYTES
\ No newline at end of file
@@ -17,28 +17,70 @@ enum EncodingType { enc8bit, encUnicode, encDBCS };
 class LexAccessor {
 private:
 	IDocument *pAccess;
+	/** When the document provides segment pointers, characters and styles are read directly
+	 * from the document text instead of being copied into @a buf. */
+	IDocumentWithSegments *pSegments;
+	/** When the document accepts style runs, styling is collected as runs rather than bytes. */
+	IDocumentWithStyleRuns *pRuns;
 	enum {extremePosition=0x7FFFFFFF};
 	/** @a bufferSize is a trade off between time taken to copy the characters
 	 * and retrieval overhead.
 	 * @a slopSize positions the buffer before the desired position
 	 * in case there is some backtracking. */
-	enum {bufferSize=4000, slopSize=bufferSize/8};
+	enum {bufferSize=4000, slopSize=bufferSize/8, runsSize=bufferSize/8};
 	char buf[bufferSize+1];
+	const char *text;	// buf or a segment of the document with text[0] at startPos
 	int startPos;
 	int endPos;
+	mutable const char *styles;	// Segment of the document styles with styles[0] at startStyles
+	mutable int startStyles;
+	mutable int endStyles;
 	int codePage;
 	enum EncodingType encodingType;
 	int lenDoc;
 	int mask;
 	char styleBuf[bufferSize];
 	int validLen;
+	int runLengths[runsSize];
+	char runStyles[runsSize];
+	int validRuns;
 	char chFlags;
 	char chWhile;
 	unsigned int startSeg;
 	int startPosStyling;
 	int documentVersion;
 
+	void ColourRun(int length, int chAttr) {
+		// As for the byte buffer, flags are not applied to runs too long to buffer
+		if (length < bufferSize) {
+			if (chAttr != chWhile)
+				chFlags = 0;
+			chAttr = static_cast<char>(chAttr | chFlags);
+		}
+		assert((startPosStyling + validLen + length) <= Length());
+		if (validLen + length >= bufferSize)
+			Flush();
+		if ((validRuns > 0) && (runStyles[validRuns-1] == static_cast<char>(chAttr))) {
+			runLengths[validRuns-1] += length;
+		} else {
+			if (validRuns >= runsSize)
+				Flush();
+			runLengths[validRuns] = length;
+			runStyles[validRuns] = static_cast<char>(chAttr);
+			validRuns++;
+		}
+		validLen += length;
+		// Keep styles visible to StyleAt as soon as the byte buffer would have
+		if (validLen >= bufferSize)
+			Flush();
+	}
+
 	void Fill(int position) {
+		if (pSegments && (position >= 0) && (position < lenDoc)) {
+			text = pSegments->SegmentPointer(position, &startPos, &endPos);
+			return;
+		}
+		text = buf;
 		startPos = position - slopSize;
 		if (startPos + bufferSize > lenDoc)
 			startPos = lenDoc - bufferSize;
@@ -54,11 +96,12 @@ private:
 
 public:
 	LexAccessor(IDocument *pAccess_) :
-		pAccess(pAccess_), startPos(extremePosition), endPos(0),
+		pAccess(pAccess_), pSegments(0), pRuns(0), text(buf), startPos(extremePosition), endPos(0),
+		styles(0), startStyles(extremePosition), endStyles(0),
 		codePage(pAccess->CodePage()), 
 		encodingType(enc8bit),
 		lenDoc(pAccess->Length()),
-		mask(127), validLen(0), chFlags(0), chWhile(0),
+		mask(127), validLen(0), validRuns(0), chFlags(0), chWhile(0),
 		startSeg(0), startPosStyling(0), 
 		documentVersion(pAccess->Version()) {
 		switch (codePage) {
@@ -72,12 +115,18 @@ public:
 		case 1361:
 			encodingType = encDBCS;
 		}
+		if (documentVersion >= dvSegments) {
+			pSegments = static_cast<IDocumentWithSegments *>(pAccess);
+		}
+		if (documentVersion >= dvStyleRuns) {
+			pRuns = static_cast<IDocumentWithStyleRuns *>(pAccess);
+		}
 	}
 	char operator[](int position) {
 		if (position < startPos || position >= endPos) {
 			Fill(position);
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	IDocumentWithLineEnd *MultiByteAccess() const {
 		if (documentVersion >= dvLineEnd) {
@@ -94,7 +143,7 @@ public:
 				return chDefault;
 			}
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	bool IsLeadByte(char ch) const {
 		return pAccess->IsDBCSLeadByte(ch);
@@ -111,8 +160,40 @@ public:
 		return true;
 	}
 	char StyleAt(int position) const {
+		if (pSegments && (position >= 0) && (position < lenDoc)) {
+			if (position < startStyles || position >= endStyles) {
+				styles = pSegments->StyleSegmentPointer(position, &startStyles, &endStyles);
+			}
+			return static_cast<char>(styles[position - startStyles] & mask);
+		}
 		return static_cast<char>(pAccess->StyleAt(position) & mask);
 	}
+	/** Find the end of the run of characters styled the same as @a position, stopping at @a limit.
+	 * Styles are compared in place in the document segments so no call is made per character. */
+	int StyleRunEnd(int position, int limit) const {
+		const char style = StyleAt(position);
+		if (limit > lenDoc)
+			limit = lenDoc;
+		if (!pSegments) {
+			while ((position < limit) && (StyleAt(position) == style))
+				position++;
+			return position;
+		}
+		while (position < limit) {
+			if (position < startStyles || position >= endStyles) {
+				styles = pSegments->StyleSegmentPointer(position, &startStyles, &endStyles);
+			}
+			const int end = (endStyles < limit) ? endStyles : limit;
+			const char *ps = styles + (position - startStyles);
+			const char *psEnd = styles + (end - startStyles);
+			while ((ps < psEnd) && (static_cast<char>(*ps & mask) == style))
+				ps++;
+			position = startStyles + static_cast<int>(ps - styles);
+			if (ps < psEnd)
+				break;
+		}
+		return position;
+	}
 	int GetLine(int position) const {
 		return pAccess->LineFromPosition(position);
 	}
@@ -140,8 +221,14 @@ public:
 	}
 	void Flush() {
 		startPos = extremePosition;
+		startStyles = extremePosition;
 		if (validLen > 0) {
-			pAccess->SetStyles(validLen, styleBuf);
+			if (pRuns) {
+				pRuns->SetStyleRuns(validRuns, runLengths, runStyles);
+				validRuns = 0;
+			} else {
+				pAccess->SetStyles(validLen, styleBuf);
+			}
 			startPosStyling += validLen;
 			validLen = 0;
 		}
@@ -177,18 +264,22 @@ public:
 				return;
 			}
 
-			if (validLen + (pos - startSeg + 1) >= bufferSize)
-				Flush();
-			if (validLen + (pos - startSeg + 1) >= bufferSize) {
-				// Too big for buffer so send directly
-				pAccess->SetStyleFor(pos - startSeg + 1, static_cast<char>(chAttr));
+			if (pRuns) {
+				ColourRun(pos - startSeg + 1, chAttr);
 			} else {
-				if (chAttr != chWhile)
-					chFlags = 0;
-				chAttr = static_cast<char>(chAttr | chFlags);
-				for (unsigned int i = startSeg; i <= pos; i++) {
-					assert((startPosStyling + validLen) < Length());
-					styleBuf[validLen++] = static_cast<char>(chAttr);
+				if (validLen + (pos - startSeg + 1) >= bufferSize)
+					Flush();
+				if (validLen + (pos - startSeg + 1) >= bufferSize) {
+					// Too big for buffer so send directly
+					pAccess->SetStyleFor(pos - startSeg + 1, static_cast<char>(chAttr));
+				} else {
+					if (chAttr != chWhile)
+						chFlags = 0;
+					chAttr = static_cast<char>(chAttr | chFlags);
+					for (unsigned int i = startSeg; i <= pos; i++) {
+						assert((startPosStyling + validLen) < Length());
+						styleBuf[validLen++] = static_cast<char>(chAttr);
+					}
 				}
 			}
 		}
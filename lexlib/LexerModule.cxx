@@ -35,13 +35,17 @@ LexerModule::LexerModule(int language_,
 	const char *languageName_,
 	LexerFunction fnFolder_,
         const char *const wordListDescriptions_[],
-	int styleBits_) :
+	int styleBits_,
+	int restartStyle_,
+	RestartFunction fnRestart_) :
 	language(language_),
 	fnLexer(fnLexer_),
 	fnFolder(fnFolder_),
 	fnFactory(0),
 	wordListDescriptions(wordListDescriptions_),
 	styleBits(styleBits_),
+	restartStyle(restartStyle_),
+	fnRestart(fnRestart_),
 	languageName(languageName_) {
 }
 
@@ -56,6 +60,8 @@ LexerModule::LexerModule(int language_,
 	fnFactory(fnFactory_),
 	wordListDescriptions(wordListDescriptions_),
 	styleBits(styleBits_),
+	restartStyle(0),
+	fnRestart(0),
 	languageName(languageName_) {
 }
 
@@ -86,6 +92,10 @@ int LexerModule::GetStyleBitsNeeded() const {
 	return styleBits;
 }
 
+bool LexerModule::IsRestart(int style, int lineState) const {
+	return fnRestart && fnRestart(style, lineState);
+}
+
 ILexer *LexerModule::Create() const {
 	if (fnFactory)
 		return fnFactory();
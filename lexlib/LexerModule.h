@@ -18,6 +18,7 @@ class WordList;
 typedef void (*LexerFunction)(unsigned int startPos, int lengthDoc, int initStyle,
                   WordList *keywordlists[], Accessor &styler);
 typedef ILexer *(*LexerFactoryFunction)();
+typedef bool (*RestartFunction)(int style, int lineState);
 
 /**
  * A LexerModule is responsible for lexing and folding a particular language.
@@ -32,6 +33,8 @@ protected:
 	LexerFactoryFunction fnFactory;
 	const char * const * wordListDescriptions;
 	int styleBits;
+	int restartStyle;
+	RestartFunction fnRestart;
 
 public:
 	const char *languageName;
@@ -40,7 +43,9 @@ public:
 		const char *languageName_=0,
 		LexerFunction fnFolder_=0,
 		const char * const wordListDescriptions_[] = NULL,
-		int styleBits_=5);
+		int styleBits_=5,
+		int restartStyle_=0,
+		RestartFunction fnRestart_=0);
 	LexerModule(int language_,
 		LexerFactoryFunction fnFactory_,
 		const char *languageName_,
@@ -56,6 +61,12 @@ public:
 
 	int GetStyleBitsNeeded() const;
 
+	// Lines after a line ending in a style and line state accepted by fnRestart can be lexed
+	// independently starting with restartStyle. See ILexerRestarts.
+	bool HasRestarts() const { return fnRestart != 0; }
+	int RestartStyle() const { return restartStyle; }
+	bool IsRestart(int style, int lineState) const;
+
 	ILexer *Create() const;
 
 	virtual void Lex(unsigned int startPos, int length, int initStyle,
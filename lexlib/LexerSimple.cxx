@@ -55,3 +55,17 @@ void SCI_METHOD LexerSimple::Fold(unsigned int startPos, int lengthDoc, int init
 		astyler.Flush();
 	}
 }
+
+void * SCI_METHOD LexerSimple::PrivateCall(int operation, void *pointer) {
+	if ((operation == pcRestarts) && module->HasRestarts())
+		return static_cast<ILexerRestarts *>(this);
+	return LexerBase::PrivateCall(operation, pointer);
+}
+
+int SCI_METHOD LexerSimple::RestartStyle() {
+	return module->RestartStyle();
+}
+
+bool SCI_METHOD LexerSimple::IsRestart(int style, int lineState) {
+	return module->IsRestart(style, lineState);
+}
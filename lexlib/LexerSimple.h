@@ -13,7 +13,7 @@ namespace Scintilla {
 #endif
 
 // A simple lexer with no state
-class LexerSimple : public LexerBase {
+class LexerSimple : public LexerBase, public ILexerRestarts {
 	const LexerModule *module;
 	std::string wordLists;
 public:
@@ -21,6 +21,9 @@ public:
 	const char * SCI_METHOD DescribeWordListSets();
 	void SCI_METHOD Lex(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess);
 	void SCI_METHOD Fold(unsigned int startPos, int lengthDoc, int initStyle, IDocument *pAccess);
+	void * SCI_METHOD PrivateCall(int operation, void *pointer);
+	int SCI_METHOD RestartStyle();
+	bool SCI_METHOD IsRestart(int style, int lineState);
 };
 
 #ifdef SCI_NAMESPACE
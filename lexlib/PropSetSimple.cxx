@@ -17,7 +17,7 @@
 #endif
 
 #include <string>
-#include <map>
+#include <vector>
 
 #include "PropSetSimple.h"
 
@@ -25,28 +25,120 @@
 using namespace Scintilla;
 #endif
 
-typedef std::map<std::string, std::string> mapss;
+namespace {
+
+/**
+ * One property with its key and value held together so the key is stored once.
+ * Values that do not refer to other properties are converted to an integer when set so
+ * reading them never modifies the table and may be performed from several threads.
+ */
+struct Property {
+	std::string key;
+	std::string value;
+	unsigned int hash;
+	bool expands;	// Value contains $(variable) so must be expanded when read
+	bool intEmpty;	// Value is empty so the default is returned
+	int intValue;
+	Property(const char *key_, size_t lenKey, unsigned int hash_) :
+		key(key_, lenKey), hash(hash_), expands(false), intEmpty(true), intValue(0) {
+	}
+	void SetValue(const char *val, size_t lenVal) {
+		value.assign(val, lenVal);
+		expands = value.find("$(") != std::string::npos;
+		intEmpty = value.empty();
+		intValue = atoi(value.c_str());
+	}
+};
+
+/**
+ * Open addressing hash table of properties.
+ * Properties are never removed and are allocated individually so the strings returned by
+ * Get stay valid until the property is set again.
+ */
+class PropertyTable {
+	std::vector<Property *> properties;
+	std::vector<int> slots;	// Index into properties or -1 for an empty slot
+	// Private so PropertyTable objects can not be copied
+	PropertyTable(const PropertyTable &);
+	void Grow() {
+		std::vector<int> slotsNew(slots.empty() ? 64 : slots.size() * 2, -1);
+		const size_t mask = slotsNew.size() - 1;
+		for (size_t i = 0; i < properties.size(); i++) {
+			size_t slot = properties[i]->hash & mask;
+			while (slotsNew[slot] >= 0)
+				slot = (slot + 1) & mask;
+			slotsNew[slot] = static_cast<int>(i);
+		}
+		slots.swap(slotsNew);
+	}
+public:
+	PropertyTable() {
+	}
+	~PropertyTable() {
+		for (size_t i = 0; i < properties.size(); i++)
+			delete properties[i];
+	}
+	static unsigned int Hash(const char *key, size_t lenKey) {
+		// FNV-1a
+		unsigned int hash = 2166136261u;
+		for (size_t i = 0; i < lenKey; i++) {
+			hash ^= static_cast<unsigned char>(key[i]);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+	const Property *Find(const char *key, size_t lenKey) const {
+		if (slots.empty())
+			return 0;
+		const size_t mask = slots.size() - 1;
+		const unsigned int hash = Hash(key, lenKey);
+		for (size_t slot = hash & mask; slots[slot] >= 0; slot = (slot + 1) & mask) {
+			const Property *property = properties[slots[slot]];
+			if ((property->hash == hash) && (property->key.length() == lenKey) &&
+				(memcmp(property->key.c_str(), key, lenKey) == 0))
+				return property;
+		}
+		return 0;
+	}
+	void Set(const char *key, size_t lenKey, const char *val, size_t lenVal) {
+		Property *property = const_cast<Property *>(Find(key, lenKey));
+		if (!property) {
+			if ((properties.size() + 1) * 2 > slots.size())
+				Grow();
+			property = new Property(key, lenKey, Hash(key, lenKey));
+			const size_t mask = slots.size() - 1;
+			size_t slot = property->hash & mask;
+			while (slots[slot] >= 0)
+				slot = (slot + 1) & mask;
+			slots[slot] = static_cast<int>(properties.size());
+			properties.push_back(property);
+		}
+		property->SetValue(val, lenVal);
+	}
+};
+
+}
 
 PropSetSimple::PropSetSimple() {
-	mapss *props = new mapss;
+	PropertyTable *props = new PropertyTable;
 	impl = static_cast<void *>(props);
 }
 
 PropSetSimple::~PropSetSimple() {
-	mapss *props = static_cast<mapss *>(impl);
+	PropertyTable *props = static_cast<PropertyTable *>(impl);
 	delete props;
 	impl = 0;
 }
 
 void PropSetSimple::Set(const char *key, const char *val, int lenKey, int lenVal) {
-	mapss *props = static_cast<mapss *>(impl);
+	PropertyTable *props = static_cast<PropertyTable *>(impl);
 	if (!*key)	// Empty keys are not supported
 		return;
 	if (lenKey == -1)
 		lenKey = static_cast<int>(strlen(key));
 	if (lenVal == -1)
 		lenVal = static_cast<int>(strlen(val));
-	(*props)[std::string(key, lenKey)] = std::string(val, lenVal);
+	props->Set(key, lenKey, val, lenVal);
 }
 
 static bool IsASpaceCharacter(unsigned int ch) {
@@ -79,10 +171,10 @@ void PropSetSimple::SetMultiple(const char *s) {
 }
 
 const char *PropSetSimple::Get(const char *key) const {
-	mapss *props = static_cast<mapss *>(impl);
-	mapss::const_iterator keyPos = props->find(std::string(key));
-	if (keyPos != props->end()) {
-		return keyPos->second.c_str();
+	const PropertyTable *props = static_cast<PropertyTable *>(impl);
+	const Property *property = props->Find(key, strlen(key));
+	if (property) {
+		return property->value.c_str();
 	} else {
 		return "";
 	}
@@ -152,10 +244,18 @@ int PropSetSimple::GetExpanded(const char *key, char *result) const {
 }
 
 int PropSetSimple::GetInt(const char *key, int defaultValue) const {
-	std::string val = Get(key);
-	ExpandAllInPlace(*this, val, 100, VarChain(key));
-	if (!val.empty()) {
-		return atoi(val.c_str());
+	const PropertyTable *props = static_cast<PropertyTable *>(impl);
+	const Property *property = props->Find(key, strlen(key));
+	if (!property)
+		return defaultValue;
+	if (property->expands) {
+		// Expansion may refer to any other property so is not cached
+		std::string val = property->value;
+		ExpandAllInPlace(*this, val, 100, VarChain(key));
+		if (!val.empty()) {
+			return atoi(val.c_str());
+		}
+		return defaultValue;
 	}
-	return defaultValue;
+	return property->intEmpty ? defaultValue : property->intValue;
 }
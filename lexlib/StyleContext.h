@@ -26,8 +26,10 @@ static inline int MakeLowerCase(int ch) {
 class StyleContext {
 	LexAccessor &styler;
 	IDocumentWithLineEnd *multiByteAccess;
+	bool decodeUTF8;
 	unsigned int endPos;
 	unsigned int lengthDocument;
+	int posLineEnd;
 	
 	// Used for optimizing GetRelativeCharacter
 	unsigned int posRelative;
@@ -36,19 +38,53 @@ class StyleContext {
 
 	StyleContext &operator=(const StyleContext &);
 
+	// End of line determined from line end position, allowing CR, LF,
+	// CRLF and Unicode line ends as set by document.
+	void SetLineEnd() {
+		if (currentLine < lineDocEnd)
+			posLineEnd = lineStartNext - 1;
+		else // Last line
+			posLineEnd = lineStartNext;
+	}
+
+	// Decode UTF-8 from the accessor, leaving invalid and less common sequences to the document
+	void GetNextCharUTF8() {
+		const unsigned int pos = currentPos + width;
+		const unsigned char lead = static_cast<unsigned char>(styler.SafeGetCharAt(pos, 0));
+		if (lead < 0x80) {
+			chNext = lead;
+			widthNext = 1;
+			return;
+		} else if ((lead >= 0xC2) && (lead < 0xE0)) {
+			const unsigned char trail = static_cast<unsigned char>(styler.SafeGetCharAt(pos + 1, 0));
+			if ((trail & 0xC0) == 0x80) {
+				chNext = ((lead & 0x1F) << 6) | (trail & 0x3F);
+				widthNext = 2;
+				return;
+			}
+		} else if ((lead >= 0xE1) && (lead < 0xEF) && (lead != 0xED)) {
+			// Excludes overlongs, surrogates and non-characters
+			const unsigned char trail1 = static_cast<unsigned char>(styler.SafeGetCharAt(pos + 1, 0));
+			const unsigned char trail2 = static_cast<unsigned char>(styler.SafeGetCharAt(pos + 2, 0));
+			if (((trail1 & 0xC0) == 0x80) && ((trail2 & 0xC0) == 0x80)) {
+				chNext = ((lead & 0xF) << 12) | ((trail1 & 0x3F) << 6) | (trail2 & 0x3F);
+				widthNext = 3;
+				return;
+			}
+		}
+		chNext = multiByteAccess->GetCharacterAndWidth(pos, &widthNext);
+	}
+
 	void GetNextChar() {
-		if (multiByteAccess) {
+		if (decodeUTF8) {
+			GetNextCharUTF8();
+		} else if (multiByteAccess) {
 			chNext = multiByteAccess->GetCharacterAndWidth(currentPos+width, &widthNext);
 		} else {
 			chNext = static_cast<unsigned char>(styler.SafeGetCharAt(currentPos+width, 0));
 			widthNext = 1;
 		}
-		// End of line determined from line end position, allowing CR, LF, 
-		// CRLF and Unicode line ends as set by document.
-		if (currentLine < lineDocEnd)
-			atLineEnd = static_cast<int>(currentPos) >= (lineStartNext-1);
-		else // Last line
-			atLineEnd = static_cast<int>(currentPos) >= lineStartNext;
+		atLineEnd = static_cast<int>(currentPos) >= posLineEnd;
 	}
 
 public:
@@ -69,7 +105,9 @@ public:
                         int initStyle, LexAccessor &styler_, char chMask=31) :
 		styler(styler_),
 		multiByteAccess(0),
+		decodeUTF8(false),
 		endPos(startPos + length),
+		posLineEnd(0),
 		posRelative(0),
 		currentPosLastRelative(0x7FFFFFFF),
 		offsetRelative(0),
@@ -85,6 +123,7 @@ public:
 		widthNext(1) {
 		if (styler.Encoding() != enc8bit) {
 			multiByteAccess = styler.MultiByteAccess();
+			decodeUTF8 = multiByteAccess && (styler.Encoding() == encUnicode);
 		}
 		styler.StartAt(startPos, chMask);
 		styler.StartSegment(startPos);
@@ -94,6 +133,7 @@ public:
 		if (endPos == lengthDocument)
 			endPos++;
 		lineDocEnd = styler.GetLine(lengthDocument);
+		SetLineEnd();
 		atLineStart = static_cast<unsigned int>(styler.LineStart(currentLine)) == startPos;
 
 		// Variable width is now 0 so GetNextChar gets the char at currentPos into chNext/widthNext
@@ -117,6 +157,7 @@ public:
 			if (atLineStart) {
 				currentLine++;
 				lineStartNext = styler.LineStart(currentLine+1);
+				SetLineEnd();
 			}
 			chPrev = ch;
 			currentPos += width;
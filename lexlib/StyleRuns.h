@@ -0,0 +1,125 @@
+// Scintilla source code edit control
+/** @file StyleRuns.h
+ ** Iterate over the style runs of a range for folding.
+ ** Each run is also ended at the end of each line so a folder handles each run and each
+ ** line once instead of examining every character.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef STYLERUNS_H
+#define STYLERUNS_H
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+class StyleRuns {
+	LexAccessor &styler;
+	int endPos;
+	int start;
+	int end;
+	int style;
+	int stylePrev;
+	int styleNext;
+	int line;
+	int lineEnd;	// Start of the next line or -1 when the line is not terminated
+	int visibleFrom;	// Characters before this on the line have been checked for visibility
+	bool visible;
+
+	void StartLine() {
+		lineEnd = styler.LineStart(line + 1);
+		// The last line of the document may end without line end characters
+		if ((lineEnd >= styler.Length()) && (styler.GetLine(lineEnd) == line))
+			lineEnd = -1;
+	}
+	void Measure() {
+		style = static_cast<unsigned char>(styler.StyleAt(start));
+		const int limit = ((lineEnd >= 0) && (lineEnd < endPos)) ? lineEnd : endPos;
+		end = styler.StyleRunEnd(start, limit);
+		if (end <= start)
+			end = start + 1;
+		styleNext = static_cast<unsigned char>(styler.StyleAt(end));
+	}
+public:
+	StyleRuns(unsigned int startPos, int length, int initStyle, LexAccessor &styler_) :
+		styler(styler_),
+		endPos(startPos + length),
+		start(startPos),
+		end(startPos),
+		style(initStyle),
+		stylePrev(initStyle),
+		styleNext(initStyle),
+		line(styler_.GetLine(startPos)),
+		lineEnd(-1),
+		visibleFrom(startPos),
+		visible(false) {
+		StartLine();
+		if (start < endPos)
+			Measure();
+	}
+	bool More() const {
+		return start < endPos;
+	}
+	void Forward() {
+		if (AtLineEnd()) {
+			line++;
+			StartLine();
+			visibleFrom = end;
+			visible = false;
+		}
+		stylePrev = style;
+		start = end;
+		if (start < endPos)
+			Measure();
+	}
+	/** First position of the run. */
+	int Start() const {
+		return start;
+	}
+	/** Position after the last character of the run. */
+	int End() const {
+		return end;
+	}
+	int Style() const {
+		return style;
+	}
+	/** Style of the character before the run which is initStyle for the first run. */
+	int StylePrev() const {
+		return stylePrev;
+	}
+	/** Style of the character after the run. */
+	int StyleNext() const {
+		return styleNext;
+	}
+	int Line() const {
+		return line;
+	}
+	/** Whether the previous character has a different style so this run starts a styled section
+	 * rather than continuing one from the previous line. */
+	bool StartsStyle() const {
+		return stylePrev != style;
+	}
+	/** Whether the next character has a different style. */
+	bool EndsStyle() const {
+		return styleNext != style;
+	}
+	/** Whether the last character of the run ends its line. */
+	bool AtLineEnd() const {
+		return end == lineEnd;
+	}
+	/** Whether the current line has a character that is not white space up to the end of
+	 * the run. Only the part of the line not already checked is examined. */
+	bool LineVisible() {
+		while (!visible && (visibleFrom < end)) {
+			visible = !IsASpace(styler[visibleFrom]);
+			visibleFrom++;
+		}
+		return visible;
+	}
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+#endif
@@ -67,7 +67,8 @@ static char **ArrayFromWordList(char *wordlist, int *len, bool onlyLineEnds = fa
 }
 
 WordList::WordList(bool onlyLineEnds_) :
-	words(0), list(0), len(0), onlyLineEnds(onlyLineEnds_) {
+	words(0), list(0), len(0), onlyLineEnds(onlyLineEnds_),
+	slots(0), lenSlots(0), punctuated(0), lenPunctuated(0) {
 }
 
 WordList::~WordList() { 
@@ -100,6 +101,12 @@ void WordList::Clear() {
 	words = 0;
 	list = 0;
 	len = 0;
+	delete []slots;
+	slots = 0;
+	lenSlots = 0;
+	delete []punctuated;
+	punctuated = 0;
+	lenPunctuated = 0;
 }
 
 #ifdef _MSC_VER
@@ -136,6 +143,79 @@ void WordList::Set(const char *s) {
 		unsigned char indexChar = words[l][0];
 		starts[indexChar] = l;
 	}
+	if (len >= hashThreshold)
+		BuildHash();
+}
+
+static unsigned int HashWord(const char *s) {
+	// FNV-1a
+	unsigned int hash = 2166136261u;
+	for (; *s; s++) {
+		hash ^= static_cast<unsigned char>(*s);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool IsWordCharacter(unsigned char ch) {
+	return (ch >= 0x80) || isalnum(ch) || (ch == '_');
+}
+
+void WordList::BuildHash() {
+	lenSlots = 64;
+	while (lenSlots < len * 2)
+		lenSlots *= 2;
+	slots = new int[lenSlots];
+	for (int i = 0; i < lenSlots; i++)
+		slots[i] = -1;
+	const unsigned int mask = lenSlots - 1;
+	punctuated = new int[len];
+	lenPunctuated = 0;
+	for (int w = 0; w < len; w++) {
+		unsigned int slot = HashWord(words[w]) & mask;
+		while (slots[slot] >= 0)
+			slot = (slot + 1) & mask;
+		slots[slot] = w;
+		// Words that may contain an abbreviation marker, kept in sorted order
+		for (const char *pc = words[w]; *pc; pc++) {
+			if (!IsWordCharacter(*pc)) {
+				punctuated[lenPunctuated++] = w;
+				break;
+			}
+		}
+	}
+}
+
+/** Find the index of a word equal to s in the hash table or -1 if there is none.
+ */
+int WordList::FindHashed(const char *s) const {
+	const unsigned int mask = lenSlots - 1;
+	for (unsigned int slot = HashWord(s) & mask; slots[slot] >= 0; slot = (slot + 1) & mask) {
+		const char *word = words[slots[slot]];
+		if ((word[0] == s[0]) && (strcmp(word, s) == 0))
+			return slots[slot];
+	}
+	return -1;
+}
+
+/** Check whether s starts with one of the prefix elements that start with '^'.
+ */
+bool WordList::InPrefixes(const char *s) const {
+	int j = starts[static_cast<unsigned int>('^')];
+	if (j >= 0) {
+		while (words[j][0] == '^') {
+			const char *a = words[j] + 1;
+			const char *b = s;
+			while (*a && *a == *b) {
+				a++;
+				b++;
+			}
+			if (!*a)
+				return true;
+			j++;
+		}
+	}
+	return false;
 }
 
 /** Check whether a string is in the list.
@@ -146,6 +226,8 @@ void WordList::Set(const char *s) {
 bool WordList::InList(const char *s) const {
 	if (0 == words)
 		return false;
+	if (slots)
+		return (FindHashed(s) >= 0) || InPrefixes(s);
 	unsigned char firstChar = s[0];
 	int j = starts[firstChar];
 	if (j >= 0) {
@@ -163,21 +245,7 @@ bool WordList::InList(const char *s) const {
 			j++;
 		}
 	}
-	j = starts[static_cast<unsigned int>('^')];
-	if (j >= 0) {
-		while (words[j][0] == '^') {
-			const char *a = words[j] + 1;
-			const char *b = s;
-			while (*a && *a == *b) {
-				a++;
-				b++;
-			}
-			if (!*a)
-				return true;
-			j++;
-		}
-	}
-	return false;
+	return InPrefixes(s);
 }
 
 /** similar to InList, but word s can be a substring of keyword.
@@ -189,7 +257,24 @@ bool WordList::InListAbbreviated(const char *s, const char marker) const {
 	if (0 == words)
 		return false;
 	unsigned char firstChar = s[0];
-	int j = starts[firstChar];
+	// A word without the marker matches only when equal so the hash table finds it and
+	// just the words containing punctuation have to be compared with s.
+	const bool hashed = slots && !IsWordCharacter(marker) && !strchr(s, marker);
+	if (hashed && (FindHashed(s) >= 0))
+		return true;
+	int p = 0;
+	if (hashed) {
+		// Binary search for the first punctuated word starting with firstChar
+		int upper = lenPunctuated;
+		while (p < upper) {
+			const int middle = (p + upper) / 2;
+			if (static_cast<unsigned char>(words[punctuated[middle]][0]) < firstChar)
+				p = middle + 1;
+			else
+				upper = middle;
+		}
+	}
+	int j = hashed ? ((p < lenPunctuated) ? punctuated[p] : -1) : starts[firstChar];
 	if (j >= 0) {
 		while (static_cast<unsigned char>(words[j][0]) == firstChar) {
 			bool isSubword = false;
@@ -212,24 +297,17 @@ bool WordList::InListAbbreviated(const char *s, const char marker) const {
 				if ((!*a || isSubword) && !*b)
 					return true;
 			}
-			j++;
-		}
-	}
-	j = starts[static_cast<unsigned int>('^')];
-	if (j >= 0) {
-		while (words[j][0] == '^') {
-			const char *a = words[j] + 1;
-			const char *b = s;
-			while (*a && *a == *b) {
-				a++;
-				b++;
+			if (hashed) {
+				p++;
+				if (p >= lenPunctuated)
+					break;
+				j = punctuated[p];
+			} else {
+				j++;
 			}
-			if (!*a)
-				return true;
-			j++;
 		}
 	}
-	return false;
+	return InPrefixes(s);
 }
 
 const char *WordList::WordAt(int n) const {
@@ -21,7 +21,18 @@ class WordList {
 	int len;
 	bool onlyLineEnds;	///< Delimited by any white space or only line ends
 	int starts[256];
+	// Large lists are also indexed by an open addressing hash table of word indices with
+	// -1 for empty slots and a list of the words containing punctuation for abbreviations.
+	int *slots;
+	int lenSlots;
+	int *punctuated;
+	int lenPunctuated;
+	void BuildHash();
+	int FindHashed(const char *s) const;
+	bool InPrefixes(const char *s) const;
 public:
+	/// Lists with at least this many words are hashed
+	enum { hashThreshold = 64 };
 	WordList(bool onlyLineEnds_ = false);
 	~WordList();
 	operator bool() const;
@@ -92,6 +92,7 @@ HEADERS  += \
     ../../include/Platform.h \
     ../../include/ILexer.h \
     ../../lexlib/WordList.h \
+    ../../lexlib/StyleRuns.h \
     ../../lexlib/StyleContext.h \
     ../../lexlib/SparseState.h \
     ../../lexlib/PropSetSimple.h \
@@ -6,6 +6,11 @@ import codecs, os, platform, sys, unicodedata
 
 from FileGenerator import Regenerate
 
+# Characters are looked up in two stages: catPages maps the high bits of a character
+# to a block of 1 << pageShift categories in catBlocks. Identical blocks are shared.
+pageShift = 7
+maxUnicode = 0x10ffff
+
 def findCategories(filename):
     with codecs.open(filename, "r", "UTF-8") as infile:
         lines = [x.strip() for x in infile.readlines() if "\tcc" in x]
@@ -13,23 +18,53 @@ def findCategories(filename):
     print(values)
     return [v[2:] for v in values]
 
+def characterCategories(categories):
+    """ Return a list with the category index of each character. """
+    return [categories.index(unicodedata.category(chr(ch))) for ch in range(maxUnicode + 1)]
+
+def stageTables(characterCats):
+    """ Split the categories of all characters into pages of identical blocks. """
+    blockSize = 1 << pageShift
+    blocks = []
+    blockIndex = {}
+    pages = []
+    for start in range(0, maxUnicode + 1, blockSize):
+        block = tuple(characterCats[start:start+blockSize])
+        if block not in blockIndex:
+            blockIndex[block] = len(blocks)
+            blocks.append(block)
+        pages.append(blockIndex[block])
+    return pages, blocks
+
+def formatValues(values, perLine):
+    return ["".join("%d," % v for v in values[i:i+perLine]) for i in range(0, len(values), perLine)]
+
+def tablesSource(pages, blocks, created):
+    if len(blocks) > 256:
+        raise ValueError("Too many distinct blocks for an unsigned char page table")
+    lines = [created]
+    lines.append("const int pageShift = %d;" % pageShift)
+    lines.append("")
+    lines.append("const unsigned char catPages[] = {")
+    lines.extend(formatValues(pages, 32))
+    lines.append("};")
+    lines.append("")
+    lines.append("const unsigned char catBlocks[][%d] = {" % (1 << pageShift))
+    for block in blocks:
+        rows = formatValues(block, 64)
+        lines.append("{" + rows[0])
+        lines.extend(rows[1:-1])
+        lines.append(rows[-1] + "},")
+    lines.append("};")
+    return lines
+
 def updateCharacterCategory(filename):
-    values = ["// Created with Python %s,  Unicode %s" % (
-        platform.python_version(), unicodedata.unidata_version)]
-    category = unicodedata.category(chr(0))
-    startRange = 0
-    for ch in range(sys.maxunicode):
-        uch = chr(ch)
-        if unicodedata.category(uch) != category:
-            value = startRange * 32 + categories.index(category)
-            values.append("%d," % value)
-            category = unicodedata.category(uch)
-            startRange = ch
-    value = startRange * 32 + categories.index(category)
-    values.append("%d," % value)
-
-    Regenerate(filename, "//", values)
+    created = "// Created with Python %s,  Unicode %s" % (
+        platform.python_version(), unicodedata.unidata_version)
+    pages, blocks = stageTables(characterCategories(categories))
+    Regenerate(filename, "//", tablesSource(pages, blocks, created))
 
 categories = findCategories("../lexlib/CharacterCategory.h")
 
-updateCharacterCategory("../lexlib/CharacterCategory.cxx")
+if __name__ == "__main__":
+    updateCharacterCategory("../lexlib/CharacterCategory.cxx")
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#include <vector>
 #include <algorithm>
 
 #include "Platform.h"
@@ -56,6 +57,16 @@ void LineVector::InsertLine(int line, int position, bool lineStart) {
 	}
 }
 
+/// Insert a run of lines with their start positions, each set of data moving its gap once.
+void LineVector::InsertLines(int line, const int *positions, int lines, bool lineStart) {
+	starts.InsertPartitions(line, positions, lines);
+	if (perLine) {
+		if ((line > 0) && lineStart)
+			line--;
+		perLine->InsertLines(line, lines);
+	}
+}
+
 void LineVector::SetLineStart(int line, int position) {
 	starts.SetPartitionStartPosition(line, position);
 }
@@ -393,6 +404,14 @@ int CellBuffer::GapPosition() const {
 	return substance.GapPosition();
 }
 
+const char *CellBuffer::SegmentPointer(int position, int &start, int &end) const {
+	return substance.SegmentPointer(position, start, end);
+}
+
+const char *CellBuffer::StyleSegmentPointer(int position, int &start, int &end) const {
+	return style.SegmentPointer(position, start, end);
+}
+
 // The char* returned is to an allocation owned by the undo history
 const char *CellBuffer::InsertString(int position, const char *s, int insertLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
@@ -421,16 +440,49 @@ bool CellBuffer::SetStyleAt(int position, char styleValue, char mask) {
 }
 
 bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue, char mask) {
+	int firstChanged = 0;
+	int lastChanged = 0;
+	return SetStyleRun(position, lengthStyle, styleValue, mask, firstChanged, lastChanged);
+}
+
+/**
+ * Set the style of a run of characters working directly on each side of the gap.
+ * When styles change, @a firstChanged and @a lastChanged are set to the first and
+ * last positions changed.
+ */
+bool CellBuffer::SetStyleRun(int position, int lengthStyle, char styleValue, char mask, int &firstChanged, int &lastChanged) {
 	bool changed = false;
 	PLATFORM_ASSERT(lengthStyle == 0 ||
 		(lengthStyle > 0 && lengthStyle + position <= style.Length()));
-	while (lengthStyle--) {
-		char curVal = style.ValueAt(position);
-		if ((curVal & mask) != styleValue) {
-			style.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
+	styleValue &= mask;
+	while (lengthStyle > 0) {
+		int start = 0;
+		int end = 0;
+		char *segment = style.SegmentPointer(position, start, end);
+		const int lengthSegment = Platform::Minimum(lengthStyle, end - position);
+		if (lengthSegment <= 0)
+			break;
+		char *values = segment + position - start;
+		int first = 0;
+		while ((first < lengthSegment) && ((values[first] & mask) == styleValue))
+			first++;
+		if (first < lengthSegment) {
+			int last = lengthSegment - 1;
+			while ((values[last] & mask) == styleValue)
+				last--;
+			if (mask == '\377') {
+				memset(values + first, styleValue, last - first + 1);
+			} else {
+				for (int i = first; i <= last; i++)
+					values[i] = static_cast<char>((values[i] & ~mask) | styleValue);
+			}
+			if (!changed)
+				firstChanged = position + first;
+			lastChanged = position + last;
 			changed = true;
 		}
-		position++;
+		position += lengthSegment;
+		lengthStyle -= lengthSegment;
 	}
 	return changed;
 }
@@ -508,6 +560,11 @@ void CellBuffer::InsertLine(int line, int position, bool lineStart) {
 	lv.InsertLine(line, position, lineStart);
 }
 
+void CellBuffer::InsertLines(int line, const int *positions, int lines, bool lineStart) {
+	if (lines > 0)
+		lv.InsertLines(line, positions, lines, lineStart);
+}
+
 void CellBuffer::RemoveLine(int line) {
 	lv.RemoveLine(line);
 }
@@ -533,29 +590,30 @@ void CellBuffer::ResetLineEnds() {
 	lv.InsertText(lineInsert-1, length);
 	unsigned char chBeforePrev = 0;
 	unsigned char chPrev = 0;
+	// Line starts are collected and inserted together once the text has been scanned
+	std::vector<int> lineStarts;
 	for (int i = 0; i < length; i++) {
 		unsigned char ch = substance.ValueAt(position + i);
 		if (ch == '\r') {
-			InsertLine(lineInsert, (position + i) + 1, atLineStart);
-			lineInsert++;
+			lineStarts.push_back((position + i) + 1);
 		} else if (ch == '\n') {
 			if (chPrev == '\r') {
 				// Patch up what was end of line
-				lv.SetLineStart(lineInsert - 1, (position + i) + 1);
+				lineStarts.back() = (position + i) + 1;
 			} else {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
+				lineStarts.push_back((position + i) + 1);
 			}
 		} else if (utf8LineEnds) {
 			unsigned char back3[3] = {chBeforePrev, chPrev, ch};
 			if (UTF8IsSeparator(back3) || UTF8IsNEL(back3+1)) {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
+				lineStarts.push_back((position + i) + 1);
 			}
 		}
 		chBeforePrev = chPrev;
 		chPrev = ch;
 	}
+	if (!lineStarts.empty())
+		InsertLines(lineInsert, &lineStarts[0], static_cast<int>(lineStarts.size()), atLineStart);
 }
 
 void CellBuffer::BasicInsertString(int position, const char *s, int insertLength) {
@@ -587,29 +645,35 @@ void CellBuffer::BasicInsertString(int position, const char *s, int insertLength
 		RemoveLine(lineInsert);
 	}
 	unsigned char ch = ' ';
+	// Line starts are collected and inserted together once the text has been scanned
+	std::vector<int> lineStarts;
 	for (int i = 0; i < insertLength; i++) {
 		ch = s[i];
 		if (ch == '\r') {
-			InsertLine(lineInsert, (position + i) + 1, atLineStart);
-			lineInsert++;
+			lineStarts.push_back((position + i) + 1);
 		} else if (ch == '\n') {
 			if (chPrev == '\r') {
 				// Patch up what was end of line
-				lv.SetLineStart(lineInsert - 1, (position + i) + 1);
+				if (lineStarts.empty())
+					lv.SetLineStart(lineInsert - 1, (position + i) + 1);
+				else
+					lineStarts.back() = (position + i) + 1;
 			} else {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
+				lineStarts.push_back((position + i) + 1);
 			}
 		} else if (utf8LineEnds) {
 			unsigned char back3[3] = {chBeforePrev, chPrev, ch};
 			if (UTF8IsSeparator(back3) || UTF8IsNEL(back3+1)) {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
+				lineStarts.push_back((position + i) + 1);
 			}
 		}
 		chBeforePrev = chPrev;
 		chPrev = ch;
 	}
+	if (!lineStarts.empty()) {
+		InsertLines(lineInsert, &lineStarts[0], static_cast<int>(lineStarts.size()), atLineStart);
+		lineInsert += static_cast<int>(lineStarts.size());
+	}
 	// Joining two lines where last insertion is cr and following substance starts with lf
 	if (chAfter == '\n') {
 		if (ch == '\r') {
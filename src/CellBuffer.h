@@ -18,6 +18,7 @@ public:
 	virtual ~PerLine() {}
 	virtual void Init()=0;
 	virtual void InsertLine(int)=0;
+	virtual void InsertLines(int, int)=0;
 	virtual void RemoveLine(int)=0;
 };
 
@@ -38,6 +39,7 @@ public:
 
 	void InsertText(int line, int delta);
 	void InsertLine(int line, int position, bool lineStart);
+	void InsertLines(int line, const int *positions, int lines, bool lineStart);
 	void SetLineStart(int line, int position);
 	void RemoveLine(int line);
 	int Lines() const {
@@ -165,6 +167,8 @@ public:
 	const char *BufferPointer();
 	const char *RangePointer(int position, int rangeLength);
 	int GapPosition() const;
+	const char *SegmentPointer(int position, int &start, int &end) const;
+	const char *StyleSegmentPointer(int position, int &start, int &end) const;
 
 	int Length() const;
 	void Allocate(int newSize);
@@ -175,6 +179,7 @@ public:
 	int LineStart(int line) const;
 	int LineFromPosition(int pos) const { return lv.LineFromPosition(pos); }
 	void InsertLine(int line, int position, bool lineStart);
+	void InsertLines(int line, const int *positions, int lines, bool lineStart);
 	void RemoveLine(int line);
 	const char *InsertString(int position, const char *s, int insertLength, bool &startSequence);
 
@@ -182,6 +187,7 @@ public:
 	/// @return true if the style of a character is changed.
 	bool SetStyleAt(int position, char styleValue, char mask='\377');
 	bool SetStyleFor(int position, int length, char styleValue, char mask);
+	bool SetStyleRun(int position, int lengthStyle, char styleValue, char mask, int &firstChanged, int &lastChanged);
 
 	const char *DeleteChars(int position, int deleteLength, bool &startSequence);
 
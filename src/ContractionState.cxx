@@ -7,6 +7,7 @@
 
 #include <string.h>
 
+#include <vector>
 #include <algorithm>
 
 #include "Platform.h"
@@ -154,13 +155,12 @@ bool ContractionState::SetVisible(int lineDocStart, int lineDocEnd, bool visible
 		int delta = 0;
 		Check();
 		if ((lineDocStart <= lineDocEnd) && (lineDocStart >= 0) && (lineDocEnd < LinesInDoc())) {
-			for (int line = lineDocStart; line <= lineDocEnd; line++) {
-				if (GetVisible(line) != visible_) {
-					int difference = visible_ ? heights->ValueAt(line) : -heights->ValueAt(line);
-					visible->SetValueAt(line, visible_ ? 1 : 0);
-					displayLines->InsertText(line, difference);
-					delta += difference;
-				}
+			bool changed = false;
+			delta = MoveDisplayLines(lineDocStart, lineDocEnd + 1, visible_, changed);
+			if (changed) {
+				int lineFill = lineDocStart;
+				int lengthFill = lineDocEnd - lineDocStart + 1;
+				visible->FillRange(lineFill, visible_ ? 1 : 0, lengthFill);
 			}
 		} else {
 			return false;
@@ -170,6 +170,65 @@ bool ContractionState::SetVisible(int lineDocStart, int lineDocEnd, bool visible
 	}
 }
 
+/**
+ * Set the visibility of several ranges of lines given as (lineDocStart, lineCount, visible)
+ * triples in ascending order without overlaps. The visible flags are set together in one pass.
+ */
+bool ContractionState::SetVisibleRanges(int ranges, const int *linesVisible) {
+	if (OneToOne()) {
+		bool hiding = false;
+		for (int range = 0; range < ranges; range++) {
+			if (!linesVisible[range * 3 + 2])
+				hiding = true;
+		}
+		if (!hiding)
+			return false;
+	}
+	EnsureData();
+	int delta = 0;
+	Check();
+	std::vector<int> fills;
+	for (int range = 0; range < ranges; range++) {
+		const int *lineVisible = linesVisible + range * 3;
+		const int lineDocStart = lineVisible[0];
+		const int lineDocEnd = lineDocStart + lineVisible[1];
+		if ((lineDocStart < lineDocEnd) && (lineDocStart >= 0) && (lineDocEnd <= LinesInDoc())) {
+			bool changed = false;
+			delta += MoveDisplayLines(lineDocStart, lineDocEnd, lineVisible[2] != 0, changed);
+			if (changed) {
+				fills.push_back(lineDocStart);
+				fills.push_back(lineVisible[1]);
+				fills.push_back(lineVisible[2] ? 1 : 0);
+			}
+		}
+	}
+	if (!fills.empty()) {
+		visible->FillRanges(static_cast<int>(fills.size() / 3), &fills[0]);
+	}
+	Check();
+	return delta != 0;
+}
+
+// Change displayLines for the lines from lineDocStart up to lineDocEnd becoming visible or
+// hidden. Works through runs of lines with the same visibility and height so the display lines
+// are moved once for each run. Returns the change in the number of display lines.
+int ContractionState::MoveDisplayLines(int lineDocStart, int lineDocEnd, bool visible_, bool &changed) {
+	const int valueVisible = visible_ ? 1 : 0;
+	int delta = 0;
+	int line = lineDocStart;
+	while (line < lineDocEnd) {
+		const int lineEndRun = std::min(std::min(visible->EndRun(line), heights->EndRun(line)), lineDocEnd);
+		if (visible->ValueAt(line) != valueVisible) {
+			int difference = visible_ ? heights->ValueAt(line) : -heights->ValueAt(line);
+			displayLines->InsertTextEach(line, lineEndRun - line, difference);
+			delta += difference * (lineEndRun - line);
+			changed = true;
+		}
+		line = lineEndRun;
+	}
+	return delta;
+}
+
 bool ContractionState::HiddenLines() const {
 	if (OneToOne()) {
 		return false;
@@ -23,6 +23,7 @@ class ContractionState {
 	int linesInDocument;
 
 	void EnsureData();
+	int MoveDisplayLines(int lineDocStart, int lineDocEnd, bool visible_, bool &changed);
 
 	bool OneToOne() const {
 		// True when each document line is exactly one display line so need for
@@ -48,6 +49,7 @@ public:
 
 	bool GetVisible(int lineDoc) const;
 	bool SetVisible(int lineDocStart, int lineDocEnd, bool visible);
+	bool SetVisibleRanges(int ranges, const int *linesVisible);
 	bool HiddenLines() const;
 
 	bool GetExpanded(int lineDoc) const;
@@ -35,6 +35,8 @@ bool Decoration::Empty() const {
 
 DecorationList::DecorationList() : currentIndicator(0), currentValue(1), current(0),
 	lengthDocument(0), root(0), clickNotified(false) {
+	for (int indicator = 0; indicator <= INDIC_MAX; indicator++)
+		indexed[indicator] = 0;
 }
 
 DecorationList::~DecorationList() {
@@ -48,7 +50,9 @@ DecorationList::~DecorationList() {
 	current = 0;
 }
 
-Decoration *DecorationList::DecorationFromIndicator(int indicator) {
+Decoration *DecorationList::DecorationFromIndicator(int indicator) const {
+	if ((indicator >= 0) && (indicator <= INDIC_MAX))
+		return indexed[indicator];
 	for (Decoration *deco=root; deco; deco = deco->next) {
 		if (deco->indicator == indicator) {
 			return deco;
@@ -76,6 +80,8 @@ Decoration *DecorationList::Create(int indicator, int length) {
 		decoNew->next = deco;
 		decoPrev->next = decoNew;
 	}
+	if ((indicator >= 0) && (indicator <= INDIC_MAX))
+		indexed[indicator] = decoNew;
 	return decoNew;
 }
 
@@ -98,6 +104,8 @@ void DecorationList::Delete(int indicator) {
 		}
 	}
 	if (decoToDelete) {
+		if ((indicator >= 0) && (indicator <= INDIC_MAX))
+			indexed[indicator] = 0;
 		delete decoToDelete;
 		current = 0;
 	}
@@ -121,21 +129,74 @@ bool DecorationList::FillRange(int &position, int value, int &fillLength) {
 		}
 	}
 	bool changed = current->rs.FillRange(position, value, fillLength);
+	if (changed) {
+		SetAllOn(currentIndicator, position, fillLength, value != 0);
+	}
+	if (current->Empty()) {
+		Delete(currentIndicator);
+	}
+	return changed;
+}
+
+// Fill triples of position, length and value for the current indicator.
+bool DecorationList::FillRanges(int ranges, const int *fills) {
+	if (!current) {
+		current = DecorationFromIndicator(currentIndicator);
+		if (!current) {
+			current = Create(currentIndicator, lengthDocument);
+		}
+	}
+	bool changed = current->rs.FillRanges(ranges, fills);
+	if (changed) {
+		for (int range = 0; range < ranges; range++) {
+			const int *fill = fills + range * 3;
+			if ((fill[0] >= 0) && (fill[1] > 0) && (fill[0] + fill[1] <= lengthDocument))
+				SetAllOn(currentIndicator, fill[0], fill[1], fill[2] != 0);
+		}
+	}
 	if (current->Empty()) {
 		Delete(currentIndicator);
 	}
 	return changed;
 }
 
+// Set or clear the bit for an indicator in the combined runs over a range.
+void DecorationList::SetAllOn(int indicator, int position, int fillLength, bool on) {
+	if ((indicator < 0) || (indicator > INDIC_MAX))
+		return;
+	const int bit = 1 << indicator;
+	const int end = position + fillLength;
+	while (position < end) {
+		const int mask = allOn.ValueAt(position);
+		const int endRun = std::min(allOn.EndRun(position), end);
+		const int maskNew = on ? (mask | bit) : (mask & ~bit);
+		if (maskNew != mask) {
+			int positionFill = position;
+			int lengthFill = endRun - position;
+			allOn.FillRange(positionFill, maskNew, lengthFill);
+		}
+		position = endRun;
+	}
+}
+
 void DecorationList::InsertSpace(int position, int insertLength) {
 	const bool atEnd = position == lengthDocument;
 	lengthDocument += insertLength;
+	int mask = 0;
 	for (Decoration *deco=root; deco; deco = deco->next) {
 		deco->rs.InsertSpace(position, insertLength);
 		if (atEnd) {
-			deco->rs.FillRange(position, 0, insertLength);
+			int positionFill = position;
+			int lengthFill = insertLength;
+			deco->rs.FillRange(positionFill, 0, lengthFill);
+		} else if (deco->rs.ValueAt(position) && (deco->indicator >= 0) && (deco->indicator <= INDIC_MAX)) {
+			mask |= 1 << deco->indicator;
 		}
 	}
+	// The inserted text takes each indicator from the run it joined which may differ between
+	// indicators so set the combined bits directly.
+	allOn.InsertSpace(position, insertLength);
+	allOn.FillRange(position, mask, insertLength);
 }
 
 void DecorationList::DeleteRange(int position, int deleteLength) {
@@ -144,6 +205,11 @@ void DecorationList::DeleteRange(int position, int deleteLength) {
 	for (deco=root; deco; deco = deco->next) {
 		deco->rs.DeleteRange(position, deleteLength);
 	}
+	// Removing all text leaves the value of a run behind so start again
+	if (lengthDocument == 0)
+		allOn.DeleteAll();
+	else
+		allOn.DeleteRange(position, deleteLength);
 	DeleteAnyEmpty();
 }
 
@@ -160,13 +226,13 @@ void DecorationList::DeleteAnyEmpty() {
 }
 
 int DecorationList::AllOnFor(int position) const {
-	int mask = 0;
-	for (Decoration *deco=root; deco; deco = deco->next) {
-		if (deco->rs.ValueAt(position)) {
-			mask |= 1 << deco->indicator;
-		}
-	}
-	return mask;
+	return allOn.ValueAt(position);
+}
+
+/// Whether any indicator is on in the range of positions [position, end).
+bool DecorationList::AnyOn(int position, int end) const {
+	return (position < end) && (position < lengthDocument) &&
+		(allOn.ValueAt(position) || (allOn.EndRun(position) < std::min(end, lengthDocument)));
 }
 
 int DecorationList::ValueAt(int indicator, int position) {
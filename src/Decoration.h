@@ -28,10 +28,15 @@ class DecorationList {
 	int currentValue;
 	Decoration *current;
 	int lengthDocument;
-	Decoration *DecorationFromIndicator(int indicator);
+	/// Decorations of indicators up to INDIC_MAX found without walking the list
+	Decoration *indexed[INDIC_MAX+1];
+	/// Bit set of the indicators with non-zero values over each run of the document
+	RunStyles allOn;
+	Decoration *DecorationFromIndicator(int indicator) const;
 	Decoration *Create(int indicator, int length);
 	void Delete(int indicator);
 	void DeleteAnyEmpty();
+	void SetAllOn(int indicator, int position, int fillLength, bool on);
 public:
 	Decoration *root;
 	bool clickNotified;
@@ -47,11 +52,13 @@ public:
 
 	// Returns true if some values may have changed
 	bool FillRange(int &position, int value, int &fillLength);
+	bool FillRanges(int ranges, const int *fills);
 
 	void InsertSpace(int position, int insertLength);
 	void DeleteRange(int position, int deleteLength);
 
 	int AllOnFor(int position) const;
+	bool AnyOn(int position, int end) const;
 	int ValueAt(int indicator, int position);
 	int Start(int indicator, int position);
 	int End(int indicator, int position);
@@ -14,6 +14,11 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <map>
+
+#if !defined(NO_CXX11_THREADS)
+#include <thread>
+#endif
 
 #include "Platform.h"
 
@@ -41,6 +46,339 @@ static inline bool IsPunctuation(char ch) {
 	return IsASCII(ch) && ispunct(ch);
 }
 
+/**
+ * Document seen by a lexer that is lexing one part of a range while other parts are lexed on
+ * other threads. Text is read from the real document which is not modified until all the threads
+ * have finished. Styles, line states, fold levels and other changes are kept here and then
+ * copied into the document by Commit.
+ */
+class LexBuffer : public IDocumentWithStyleRuns {
+	Document *pdoc;
+	const char *buffer;
+	int start;
+	int end;
+	int lineFirst;
+	std::vector<char> styles;
+	char stylingMask;
+	int endStyled;
+	int endStyledMax;
+	std::vector<int> lineStates;
+	std::vector<bool> lineStatesSet;
+	std::vector<int> levels;
+	std::vector<bool> levelsSet;
+	// Changes outside the lines of the range are rare so are just kept in order
+	std::vector<std::pair<int, int> > lineStatesOutside;
+	std::vector<std::pair<int, int> > levelsOutside;
+	struct Fill {
+		int indicator;
+		int position;
+		int value;
+		int fillLength;
+	};
+	int indicatorCurrent;
+	std::vector<Fill> fills;
+	std::vector<std::pair<int, int> > lexerStateChanges;
+	int errorStatus;
+	bool lexed;
+	// Private so LexBuffer objects can not be copied
+	LexBuffer(const LexBuffer &);
+	bool InLines(int line) const {
+		return (line >= lineFirst) && (line < lineFirst + static_cast<int>(lineStates.size()));
+	}
+	void SetStyleRange(int length, const char *s, char style) {
+		const int last = std::min(endStyled + length, end);
+		for (int position = std::max(endStyled, start); position < last; position++) {
+			char &styleAt = styles[position - start];
+			styleAt = static_cast<char>((styleAt & ~stylingMask) | ((s ? s[position - endStyled] : style) & stylingMask));
+		}
+		endStyled += length;
+		endStyledMax = std::max(endStyledMax, std::min(endStyled, end));
+	}
+public:
+	LexBuffer(Document *pdoc_, const char *buffer_, int start_, int end_) :
+		pdoc(pdoc_), buffer(buffer_), start(start_), end(end_), stylingMask(0),
+		endStyled(start_), endStyledMax(start_), indicatorCurrent(0), errorStatus(0), lexed(false) {
+		lineFirst = pdoc->LineFromPosition(start);
+		const int lines = pdoc->LineFromPosition(end) - lineFirst + 1;
+		lineStates.resize(lines);
+		lineStatesSet.resize(lines);
+		levels.resize(lines);
+		levelsSet.resize(lines);
+		// Start with the current styles so unstyled positions read the same as in the document
+		styles.resize(end - start);
+		for (int position = start; position < end;) {
+			int segmentStart = 0;
+			int segmentEnd = 0;
+			const char *segment = pdoc->StyleSegmentPointer(position, &segmentStart, &segmentEnd);
+			const int segmentLast = std::min(segmentEnd, end);
+			memcpy(&styles[position - start], segment + position - segmentStart, segmentLast - position);
+			position = segmentLast;
+		}
+	}
+	virtual ~LexBuffer() {
+	}
+	int Start() const {
+		return start;
+	}
+	int End() const {
+		return end;
+	}
+	bool Lexed() const {
+		return lexed;
+	}
+	void Lex(ILexer *instance, int initStyle) {
+		try {
+			instance->Lex(start, end - start, initStyle, this);
+			lexed = true;
+		} catch (...) {
+			// Lexed again on the calling thread
+			lexed = false;
+		}
+	}
+	void Commit();
+
+	int SCI_METHOD Version() const {
+		return dvStyleRuns;
+	}
+	void SCI_METHOD SetErrorStatus(int status) {
+		errorStatus = status;
+	}
+	int SCI_METHOD Length() const {
+		return pdoc->Length();
+	}
+	void SCI_METHOD GetCharRange(char *buffer_, int position, int lengthRetrieve) const {
+		pdoc->GetCharRange(buffer_, position, lengthRetrieve);
+	}
+	char SCI_METHOD StyleAt(int position) const {
+		if ((position >= start) && (position < end))
+			return styles[position - start];
+		return pdoc->StyleAt(position);
+	}
+	int SCI_METHOD LineFromPosition(int position) const {
+		return pdoc->LineFromPosition(position);
+	}
+	int SCI_METHOD LineStart(int line) const {
+		return pdoc->LineStart(line);
+	}
+	int SCI_METHOD GetLevel(int line) const {
+		if (InLines(line) && levelsSet[line - lineFirst])
+			return levels[line - lineFirst];
+		return pdoc->GetLevel(line);
+	}
+	int SCI_METHOD SetLevel(int line, int level) {
+		const int levelPrevious = GetLevel(line);
+		if (InLines(line)) {
+			levels[line - lineFirst] = level;
+			levelsSet[line - lineFirst] = true;
+		} else {
+			levelsOutside.push_back(std::pair<int, int>(line, level));
+		}
+		return levelPrevious;
+	}
+	int SCI_METHOD GetLineState(int line) const {
+		if (InLines(line) && lineStatesSet[line - lineFirst])
+			return lineStates[line - lineFirst];
+		return pdoc->GetLineState(line);
+	}
+	int SCI_METHOD SetLineState(int line, int state) {
+		const int statePrevious = GetLineState(line);
+		if (InLines(line)) {
+			lineStates[line - lineFirst] = state;
+			lineStatesSet[line - lineFirst] = true;
+		} else {
+			lineStatesOutside.push_back(std::pair<int, int>(line, state));
+		}
+		return statePrevious;
+	}
+	void SCI_METHOD StartStyling(int position, char mask) {
+		stylingMask = mask;
+		endStyled = position;
+	}
+	bool SCI_METHOD SetStyleFor(int length, char style) {
+		SetStyleRange(length, 0, style);
+		return true;
+	}
+	bool SCI_METHOD SetStyles(int length, const char *styles_) {
+		SetStyleRange(length, styles_, 0);
+		return true;
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) {
+		indicatorCurrent = indicator;
+	}
+	void SCI_METHOD DecorationFillRange(int position, int value, int fillLength) {
+		Fill fill = { indicatorCurrent, position, value, fillLength };
+		fills.push_back(fill);
+	}
+	void SCI_METHOD ChangeLexerState(int startChange, int endChange) {
+		lexerStateChanges.push_back(std::pair<int, int>(startChange, endChange));
+	}
+	int SCI_METHOD CodePage() const {
+		return pdoc->CodePage();
+	}
+	bool SCI_METHOD IsDBCSLeadByte(char ch) const {
+		return pdoc->IsDBCSLeadByte(ch);
+	}
+	const char * SCI_METHOD BufferPointer() {
+		return buffer;
+	}
+	int SCI_METHOD GetLineIndentation(int line) {
+		return pdoc->GetLineIndentation(line);
+	}
+	int SCI_METHOD LineEnd(int line) const {
+		return pdoc->LineEnd(line);
+	}
+	int SCI_METHOD GetRelativePosition(int positionStart, int characterOffset) const {
+		return pdoc->GetRelativePosition(positionStart, characterOffset);
+	}
+	int SCI_METHOD GetCharacterAndWidth(int position, int *pWidth) const {
+		return pdoc->GetCharacterAndWidth(position, pWidth);
+	}
+	const char * SCI_METHOD SegmentPointer(int position, int *segmentStart, int *segmentEnd) const {
+		return pdoc->SegmentPointer(position, segmentStart, segmentEnd);
+	}
+	const char * SCI_METHOD StyleSegmentPointer(int position, int *segmentStart, int *segmentEnd) const {
+		if ((position >= start) && (position < end)) {
+			*segmentStart = start;
+			*segmentEnd = end;
+			return &styles[0];
+		}
+		// Segment of the document clipped so that it does not overlap this range
+		const char *segment = pdoc->StyleSegmentPointer(position, segmentStart, segmentEnd);
+		if (position < start) {
+			*segmentEnd = std::min(*segmentEnd, start);
+		} else if (*segmentStart < end) {
+			segment += end - *segmentStart;
+			*segmentStart = end;
+		}
+		return segment;
+	}
+	bool SCI_METHOD SetStyleRuns(int runs, const int *lengths, const char *styles_) {
+		for (int run = 0; run < runs; run++) {
+			SetStyleRange(lengths[run], 0, styles_[run]);
+		}
+		return true;
+	}
+};
+
+void LexBuffer::Commit() {
+	if (errorStatus)
+		pdoc->SetErrorStatus(errorStatus);
+	// Styles are committed as runs so unchanged runs are cheap to set
+	std::vector<int> runLengths;
+	std::vector<char> runStyles;
+	for (int position = start; position < endStyledMax;) {
+		const char style = styles[position - start];
+		int positionEnd = position + 1;
+		while ((positionEnd < endStyledMax) && (styles[positionEnd - start] == style))
+			positionEnd++;
+		runLengths.push_back(positionEnd - position);
+		runStyles.push_back(style);
+		position = positionEnd;
+	}
+	if (!runLengths.empty()) {
+		pdoc->StartStyling(start, stylingMask);
+		pdoc->SetStyleRuns(static_cast<int>(runLengths.size()), &runLengths[0], &runStyles[0]);
+	}
+	for (size_t line = 0; line < lineStates.size(); line++) {
+		if (lineStatesSet[line])
+			pdoc->SetLineState(lineFirst + static_cast<int>(line), lineStates[line]);
+	}
+	for (size_t change = 0; change < lineStatesOutside.size(); change++) {
+		pdoc->SetLineState(lineStatesOutside[change].first, lineStatesOutside[change].second);
+	}
+	for (size_t line = 0; line < levels.size(); line++) {
+		if (levelsSet[line])
+			pdoc->SetLevel(lineFirst + static_cast<int>(line), levels[line]);
+	}
+	for (size_t change = 0; change < levelsOutside.size(); change++) {
+		pdoc->SetLevel(levelsOutside[change].first, levelsOutside[change].second);
+	}
+	for (size_t fill = 0; fill < fills.size(); fill++) {
+		pdoc->DecorationSetCurrentIndicator(fills[fill].indicator);
+		pdoc->DecorationFillRange(fills[fill].position, fills[fill].value, fills[fill].fillLength);
+	}
+	for (size_t change = 0; change < lexerStateChanges.size(); change++) {
+		pdoc->ChangeLexerState(lexerStateChanges[change].first, lexerStateChanges[change].second);
+	}
+}
+
+/**
+ * Lex a long range by splitting it at line starts into parts that are lexed on separate threads
+ * when the lexer declares that its state is reset at some line starts through ILexerRestarts.
+ * Each part after the first assumes that it starts at a restart point. The parts are then copied
+ * into the document in order and a part is lexed again when the end of the preceding part
+ * shows it did not start at a restart point.
+ * Returns false when the range was not lexed.
+ */
+bool LexInterface::LexParallel(int start, int end, int styleStart) {
+#if !defined(NO_CXX11_THREADS)
+	const int len = end - start;
+	if (len < lengthLexThread * 2)
+		return false;
+	ILexerRestarts *restarts = static_cast<ILexerRestarts *>(instance->PrivateCall(pcRestarts, 0));
+	if (!restarts)
+		return false;
+	const int threads = std::min(std::min(static_cast<int>(std::thread::hardware_concurrency()),
+		static_cast<int>(maxLexThreads)), len / lengthLexThread);
+	if (threads < 2)
+		return false;
+
+	// Perform any operations that modify the document before the threads start
+	const char *buffer = pdoc->BufferPointer();
+	pdoc->GetLineState(pdoc->LineFromPosition(end) + 1);
+
+	std::vector<LexBuffer *> parts;
+	int partStart = start;
+	for (int part = 1; part <= threads; part++) {
+		int partEnd = end;
+		if (part < threads) {
+			const int partMiddle = start + static_cast<int>(static_cast<double>(len) * part / threads);
+			partEnd = pdoc->LineStart(pdoc->LineFromPosition(partMiddle) + 1);
+		}
+		if ((partEnd > partStart) && (partEnd <= end)) {
+			parts.push_back(new LexBuffer(pdoc, buffer, partStart, partEnd));
+			partStart = partEnd;
+		}
+	}
+	if (partStart < end)
+		parts.push_back(new LexBuffer(pdoc, buffer, partStart, end));
+
+	std::vector<std::thread> workers;
+	for (size_t part = 1; part < parts.size(); part++) {
+		try {
+			workers.push_back(std::thread(&LexBuffer::Lex, parts[part], instance, restarts->RestartStyle()));
+		} catch (...) {
+			// Could not start a thread so this part and later parts are lexed below
+			break;
+		}
+	}
+	parts[0]->Lex(instance, styleStart);
+	for (size_t worker = 0; worker < workers.size(); worker++) {
+		workers[worker].join();
+	}
+
+	for (size_t part = 0; part < parts.size(); part++) {
+		LexBuffer *lb = parts[part];
+		int initStyle = styleStart;
+		bool valid = lb->Lexed();
+		if (part > 0) {
+			initStyle = pdoc->StyleAt(lb->Start() - 1) & pdoc->stylingBitsMask;
+			const int lineState = pdoc->GetLineState(pdoc->LineFromPosition(lb->Start()) - 1);
+			valid = valid && restarts->IsRestart(initStyle, lineState);
+		}
+		if (valid) {
+			lb->Commit();
+		} else {
+			instance->Lex(lb->Start(), lb->End() - lb->Start(), initStyle, pdoc);
+		}
+		delete lb;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
 void LexInterface::Colourise(int start, int end) {
 	if (pdoc && instance && !performingStyle) {
 		// Protect against reentrance, which may occur, for example, when
@@ -61,7 +399,8 @@ void LexInterface::Colourise(int start, int end) {
 			styleStart = pdoc->StyleAt(start - 1) & pdoc->stylingBitsMask;
 
 		if (len > 0) {
-			instance->Lex(start, len, styleStart, pdoc);
+			if (!LexParallel(start, end, styleStart))
+				instance->Lex(start, len, styleStart, pdoc);
 			instance->Fold(start, len, styleStart, pdoc);
 		}
 
@@ -111,8 +450,7 @@ Document::Document() {
 	UTF8BytesOfLeadInitialise();
 
 	perLineData[ldMarkers] = new LineMarkers();
-	perLineData[ldLevels] = new LineLevels();
-	perLineData[ldState] = new LineState();
+	perLineData[ldColumns] = new LineColumns();
 	perLineData[ldMargin] = new LineAnnotation();
 	perLineData[ldAnnotation] = new LineAnnotation();
 
@@ -185,6 +523,13 @@ void Document::InsertLine(int line) {
 	}
 }
 
+void Document::InsertLines(int line, int lines) {
+	for (int j=0; j<ldSize; j++) {
+		if (perLineData[j])
+			perLineData[j]->InsertLines(line, lines);
+	}
+}
+
 void Document::RemoveLine(int line) {
 	for (int j=0; j<ldSize; j++) {
 		if (perLineData[j])
@@ -219,6 +564,10 @@ int Document::MarkerNext(int lineStart, int mask) const {
 	return static_cast<LineMarkers *>(perLineData[ldMarkers])->MarkerNext(lineStart, mask);
 }
 
+int Document::MarkerPrevious(int lineStart, int mask) const {
+	return static_cast<LineMarkers *>(perLineData[ldMarkers])->MarkerPrevious(lineStart, mask);
+}
+
 int Document::AddMark(int line, int markerNum) {
 	if (line >= 0 && line <= LinesTotal()) {
 		int prev = static_cast<LineMarkers *>(perLineData[ldMarkers])->
@@ -244,6 +593,33 @@ void Document::AddMarkSet(int line, int valueSet) {
 	NotifyModified(mh);
 }
 
+// Add count markers given as pairs of line and marker number with one notification.
+// Handles are allocated in order so the marker from pair i has the returned handle plus i.
+int Document::AddMarks(int count, const int *linesAndMarkers) {
+	int handleFirst = static_cast<LineMarkers *>(perLineData[ldMarkers])->
+		AddMarks(count, linesAndMarkers, LinesTotal());
+	if (count > 0) {
+		DocModification mh(SC_MOD_CHANGEMARKER, 0, 0, 0, 0);
+		mh.line = -1;
+		NotifyModified(mh);
+	}
+	return handleFirst;
+}
+
+void Document::DeleteMarks(int count, const int *linesAndMarkers) {
+	bool someChanges = false;
+	for (int i = 0; i < count; i++) {
+		if (static_cast<LineMarkers *>(perLineData[ldMarkers])->
+			DeleteMark(linesAndMarkers[i * 2], linesAndMarkers[i * 2 + 1], false))
+			someChanges = true;
+	}
+	if (someChanges) {
+		DocModification mh(SC_MOD_CHANGEMARKER, 0, 0, 0, 0);
+		mh.line = -1;
+		NotifyModified(mh);
+	}
+}
+
 void Document::DeleteMark(int line, int markerNum) {
 	static_cast<LineMarkers *>(perLineData[ldMarkers])->DeleteMark(line, markerNum, false);
 	DocModification mh(SC_MOD_CHANGEMARKER, LineStart(line), 0, 0, 0, line);
@@ -258,12 +634,7 @@ void Document::DeleteMarkFromHandle(int markerHandle) {
 }
 
 void Document::DeleteAllMarks(int markerNum) {
-	bool someChanges = false;
-	for (int line = 0; line < LinesTotal(); line++) {
-		if (static_cast<LineMarkers *>(perLineData[ldMarkers])->DeleteMark(line, markerNum, true))
-			someChanges = true;
-	}
-	if (someChanges) {
+	if (static_cast<LineMarkers *>(perLineData[ldMarkers])->DeleteAllMarks(markerNum)) {
 		DocModification mh(SC_MOD_CHANGEMARKER, 0, 0, 0, 0);
 		mh.line = -1;
 		NotifyModified(mh);
@@ -342,7 +713,7 @@ int Document::VCHomePosition(int position) const {
 }
 
 int SCI_METHOD Document::SetLevel(int line, int level) {
-	int prev = static_cast<LineLevels *>(perLineData[ldLevels])->SetLevel(line, level, LinesTotal());
+	int prev = static_cast<LineColumns *>(perLineData[ldColumns])->SetLevel(line, level, LinesTotal());
 	if (prev != level) {
 		DocModification mh(SC_MOD_CHANGEFOLD | SC_MOD_CHANGEMARKER,
 		                   LineStart(line), 0, 0, 0, line);
@@ -354,18 +725,11 @@ int SCI_METHOD Document::SetLevel(int line, int level) {
 }
 
 int SCI_METHOD Document::GetLevel(int line) const {
-	return static_cast<LineLevels *>(perLineData[ldLevels])->GetLevel(line);
+	return static_cast<LineColumns *>(perLineData[ldColumns])->GetLevel(line);
 }
 
 void Document::ClearLevels() {
-	static_cast<LineLevels *>(perLineData[ldLevels])->ClearLevels();
-}
-
-static bool IsSubordinate(int levelStart, int levelTry) {
-	if (levelTry & SC_FOLDLEVELWHITEFLAG)
-		return true;
-	else
-		return (levelStart & SC_FOLDLEVELNUMBERMASK) < (levelTry & SC_FOLDLEVELNUMBERMASK);
+	static_cast<LineColumns *>(perLineData[ldColumns])->ClearLevels();
 }
 
 int Document::GetLastChild(int lineParent, int level, int lastLine) {
@@ -374,13 +738,27 @@ int Document::GetLastChild(int lineParent, int level, int lastLine) {
 	int maxLine = LinesTotal();
 	int lookLastLine = (lastLine != -1) ? Platform::Minimum(LinesTotal() - 1, lastLine) : -1;
 	int lineMaxSubord = lineParent;
-	while (lineMaxSubord < maxLine - 1) {
-		EnsureStyledTo(LineStart(lineMaxSubord + 2));
-		if (!IsSubordinate(level, GetLevel(lineMaxSubord + 1)))
-			break;
-		if ((lookLastLine != -1) && (lineMaxSubord >= lookLastLine) && !(GetLevel(lineMaxSubord) & SC_FOLDLEVELWHITEFLAG))
-			break;
-		lineMaxSubord++;
+	if (lineMaxSubord < maxLine - 1) {
+		const LineColumns *pll = static_cast<LineColumns *>(perLineData[ldColumns]);
+		for (;;) {
+			const int endStyledBefore = endStyled;
+			// The fold ends before the first following line that is not whitespace and
+			// not deeper than the parent
+			const int lineEnd = pll->FirstAtOrBelow(lineParent + 1, maxLine,
+				level & SC_FOLDLEVELNUMBERMASK, false);
+			lineMaxSubord = (lineEnd < 0) ? (maxLine - 1) : (lineEnd - 1);
+			if (lookLastLine != -1) {
+				// Stop early at the first line from lookLastLine that is not whitespace
+				const int lineLook = pll->FirstAtOrBelow(Platform::Maximum(lineParent, lookLastLine),
+					lineMaxSubord, SC_FOLDLEVELNUMBERMASK, false);
+				if (lineLook >= 0)
+					lineMaxSubord = lineLook;
+			}
+			// Styling may change levels so search again if more was styled
+			EnsureStyledTo(LineStart(Platform::Minimum(lineMaxSubord + 2, maxLine)));
+			if (endStyled == endStyledBefore)
+				break;
+		}
 	}
 	if (lineMaxSubord > lineParent) {
 		if (level > (GetLevel(lineMaxSubord + 1) & SC_FOLDLEVELNUMBERMASK)) {
@@ -395,19 +773,16 @@ int Document::GetLastChild(int lineParent, int level, int lastLine) {
 
 int Document::GetFoldParent(int line) const {
 	int level = GetLevel(line) & SC_FOLDLEVELNUMBERMASK;
-	int lineLook = line - 1;
-	while ((lineLook > 0) && (
-	            (!(GetLevel(lineLook) & SC_FOLDLEVELHEADERFLAG)) ||
-	            ((GetLevel(lineLook) & SC_FOLDLEVELNUMBERMASK) >= level))
-	      ) {
-		lineLook--;
-	}
-	if ((GetLevel(lineLook) & SC_FOLDLEVELHEADERFLAG) &&
-	        ((GetLevel(lineLook) & SC_FOLDLEVELNUMBERMASK) < level)) {
-		return lineLook;
-	} else {
-		return -1;
-	}
+	return static_cast<LineColumns *>(perLineData[ldColumns])->LastAtOrBelow(line - 1, level - 1, true);
+}
+
+/**
+ * Find the first fold header from lineStart with a level number no greater than levelMax.
+ * Returns -1 when there are no more fold headers.
+ */
+int Document::FoldHeaderNext(int lineStart, int levelMax) const {
+	return static_cast<LineColumns *>(perLineData[ldColumns])->FirstAtOrBelow(lineStart, LinesTotal(),
+		levelMax & SC_FOLDLEVELNUMBERMASK, true);
 }
 
 void Document::GetHighlightDelimiters(HighlightDelimiter &highlightDelimiter, int line, int lastLine) {
@@ -1721,10 +2096,11 @@ bool SCI_METHOD Document::SetStyleFor(int length, char style) {
 	} else {
 		enteredStyling++;
 		style &= stylingMask;
-		int prevEndStyled = endStyled;
-		if (cb.SetStyleFor(endStyled, length, style, stylingMask)) {
+		int startMod = 0;
+		int endMod = 0;
+		if (cb.SetStyleRun(endStyled, length, style, stylingMask, startMod, endMod)) {
 			DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
-			                   prevEndStyled, length);
+			                   startMod, endMod - startMod + 1);
 			NotifyModified(mh);
 		}
 		endStyled += length;
@@ -1761,6 +2137,38 @@ bool SCI_METHOD Document::SetStyles(int length, const char *styles) {
 	}
 }
 
+bool SCI_METHOD Document::SetStyleRuns(int runs, const int *lengths, const char *styles) {
+	if (enteredStyling != 0) {
+		return false;
+	} else {
+		enteredStyling++;
+		bool didChange = false;
+		int startMod = 0;
+		int endMod = 0;
+		for (int run = 0; run < runs; run++) {
+			PLATFORM_ASSERT(endStyled + lengths[run] <= Length());
+			int firstChanged = 0;
+			int lastChanged = 0;
+			if (cb.SetStyleRun(endStyled, lengths[run], static_cast<char>(styles[run] & stylingMask),
+				stylingMask, firstChanged, lastChanged)) {
+				if (!didChange) {
+					startMod = firstChanged;
+				}
+				didChange = true;
+				endMod = lastChanged;
+			}
+			endStyled += lengths[run];
+		}
+		if (didChange) {
+			DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
+			                   startMod, endMod - startMod + 1);
+			NotifyModified(mh);
+		}
+		enteredStyling--;
+		return true;
+	}
+}
+
 void Document::EnsureStyledTo(int pos) {
 	if ((enteredStyling == 0) && (pos > GetEndStyled())) {
 		IncrementStyleClock();
@@ -1786,7 +2194,7 @@ void Document::LexerChanged() {
 }
 
 int SCI_METHOD Document::SetLineState(int line, int state) {
-	int statePrevious = static_cast<LineState *>(perLineData[ldState])->SetLineState(line, state);
+	int statePrevious = static_cast<LineColumns *>(perLineData[ldColumns])->SetLineState(line, state);
 	if (state != statePrevious) {
 		DocModification mh(SC_MOD_CHANGELINESTATE, LineStart(line), 0, 0, 0, line);
 		NotifyModified(mh);
@@ -1795,11 +2203,11 @@ int SCI_METHOD Document::SetLineState(int line, int state) {
 }
 
 int SCI_METHOD Document::GetLineState(int line) const {
-	return static_cast<LineState *>(perLineData[ldState])->GetLineState(line);
+	return static_cast<LineColumns *>(perLineData[ldColumns])->GetLineState(line);
 }
 
 int Document::GetMaxLineState() {
-	return static_cast<LineState *>(perLineData[ldState])->GetMaxLineState();
+	return static_cast<LineColumns *>(perLineData[ldColumns])->GetMaxLineState();
 }
 
 void SCI_METHOD Document::ChangeLexerState(int start, int end) {
@@ -1854,6 +2262,42 @@ void Document::AnnotationSetText(int line, const char *text) {
 	}
 }
 
+/**
+ * Set the annotations of count lines with texts holding each annotation terminated by a NUL.
+ * An empty text removes the annotation. Sends one notification spanning the changed lines
+ * that lists each changed line with its own change in height.
+ */
+void Document::AnnotationSetTexts(int count, const int *lines, const char *texts) {
+	LineAnnotation *pla = static_cast<LineAnnotation *>(perLineData[ldAnnotation]);
+	std::vector<int> linesChanged;
+	std::vector<int> linesAddedEach;
+	int lineFirst = LinesTotal();
+	int lineLast = -1;
+	int linesAdded = 0;
+	for (int i = 0; i < count; i++) {
+		const int line = lines[i];
+		if (line >= 0 && line < LinesTotal()) {
+			const int linesBefore = pla->Lines(line);
+			pla->SetText(line, *texts ? texts : 0);
+			linesChanged.push_back(line);
+			linesAddedEach.push_back(pla->Lines(line) - linesBefore);
+			linesAdded += linesAddedEach.back();
+			lineFirst = std::min(lineFirst, line);
+			lineLast = std::max(lineLast, line);
+		}
+		texts += strlen(texts) + 1;
+	}
+	if (lineLast >= 0) {
+		DocModification mh(SC_MOD_CHANGEANNOTATION, LineStart(lineFirst),
+			LineStart(lineLast) - LineStart(lineFirst), 0, 0, lineFirst);
+		mh.annotationLinesAdded = linesAdded;
+		mh.annotationLineCount = static_cast<int>(linesChanged.size());
+		mh.annotationLines = &linesChanged[0];
+		mh.annotationLinesAddedEach = &linesAddedEach[0];
+		NotifyModified(mh);
+	}
+}
+
 void Document::AnnotationSetStyle(int line, int style) {
 	static_cast<LineAnnotation *>(perLineData[ldAnnotation])->SetStyle(line, style);
 	DocModification mh(SC_MOD_CHANGEANNOTATION, LineStart(line), 0, 0, 0, line);
@@ -1890,6 +2334,23 @@ void SCI_METHOD Document::DecorationFillRange(int position, int value, int fillL
 	}
 }
 
+void Document::DecorationFillRanges(int ranges, const int *fills) {
+	if (decorations.FillRanges(ranges, fills)) {
+		int start = Length();
+		int end = 0;
+		for (int range = 0; range < ranges; range++) {
+			if ((fills[range * 3] >= 0) && (fills[range * 3 + 1] > 0) &&
+				(fills[range * 3] + fills[range * 3 + 1] <= Length())) {
+				start = std::min(start, fills[range * 3]);
+				end = std::max(end, fills[range * 3] + fills[range * 3 + 1]);
+			}
+		}
+		DocModification mh(SC_MOD_CHANGEINDICATOR | SC_PERFORMED_USER,
+							start, end - start);
+		NotifyModified(mh);
+	}
+}
+
 bool Document::AddWatcher(DocWatcher *watcher, void *userData) {
 	WatcherWithUserData wwud(watcher, userData);
 	std::vector<WatcherWithUserData>::iterator it = 
@@ -164,7 +164,10 @@ protected:
 	Document *pdoc;
 	ILexer *instance;
 	bool performingStyle;	///< Prevent reentrance
+	bool LexParallel(int start, int end, int styleStart);
 public:
+	/// Lexers supporting ILexerRestarts lex ranges longer than twice lengthLexThread on several threads
+	enum { lengthLexThread = 0x40000, maxLexThreads = 8 };
 	LexInterface(Document *pdoc_) : pdoc(pdoc_), instance(0), performingStyle(false) {
 	}
 	virtual ~LexInterface() {
@@ -178,7 +181,7 @@ public:
 
 /**
  */
-class Document : PerLine, public IDocumentWithLineEnd, public ILoader {
+class Document : PerLine, public IDocumentWithStyleRuns, public ILoader {
 
 public:
 	/** Used to pair watcher pointer with user data. */
@@ -208,7 +211,7 @@ private:
 	std::vector<WatcherWithUserData> watchers;
 
 	// ldSize is not real data - it is for dimensions and loops
-	enum lineData { ldMarkers, ldLevels, ldState, ldMargin, ldAnnotation, ldSize };
+	enum lineData { ldMarkers, ldColumns, ldMargin, ldAnnotation, ldSize };
 	PerLine *perLineData[ldSize];
 
 	bool matchesValid;
@@ -247,10 +250,11 @@ public:
 	bool SetLineEndTypesAllowed(int lineEndBitSet_);
 	int GetLineEndTypesActive() const { return cb.GetLineEndTypes(); }
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	int SCI_METHOD Version() const {
-		return dvLineEnd;
+		return dvStyleRuns;
 	}
 
 	void SCI_METHOD SetErrorStatus(int status);
@@ -294,6 +298,12 @@ public:
 	const char * SCI_METHOD BufferPointer() { return cb.BufferPointer(); }
 	const char *RangePointer(int position, int rangeLength) { return cb.RangePointer(position, rangeLength); }
 	int GapPosition() const { return cb.GapPosition(); }
+	const char * SCI_METHOD SegmentPointer(int position, int *segmentStart, int *segmentEnd) const {
+		return cb.SegmentPointer(position, *segmentStart, *segmentEnd);
+	}
+	const char * SCI_METHOD StyleSegmentPointer(int position, int *segmentStart, int *segmentEnd) const {
+		return cb.StyleSegmentPointer(position, *segmentStart, *segmentEnd);
+	}
 
 	int SCI_METHOD GetLineIndentation(int line);
 	void SetLineIndentation(int line, int indent);
@@ -322,8 +332,11 @@ public:
 	}
 	int GetMark(int line);
 	int MarkerNext(int lineStart, int mask) const;
+	int MarkerPrevious(int lineStart, int mask) const;
 	int AddMark(int line, int markerNum);
 	void AddMarkSet(int line, int valueSet);
+	int AddMarks(int count, const int *linesAndMarkers);
+	void DeleteMarks(int count, const int *linesAndMarkers);
 	void DeleteMark(int line, int markerNum);
 	void DeleteMarkFromHandle(int markerHandle);
 	void DeleteAllMarks(int markerNum);
@@ -340,6 +353,7 @@ public:
 	void ClearLevels();
 	int GetLastChild(int lineParent, int level=-1, int lastLine=-1);
 	int GetFoldParent(int line) const;
+	int FoldHeaderNext(int lineStart, int levelMax=SC_FOLDLEVELNUMBERMASK) const;
 	void GetHighlightDelimiters(HighlightDelimiter &hDelimiter, int line, int lastLine);
 
 	void Indent(bool forwards);
@@ -363,6 +377,7 @@ public:
 	void SCI_METHOD StartStyling(int position, char mask);
 	bool SCI_METHOD SetStyleFor(int length, char style);
 	bool SCI_METHOD SetStyles(int length, const char *styles);
+	bool SCI_METHOD SetStyleRuns(int runs, const int *lengths, const char *styles);
 	int GetEndStyled() const { return endStyled; }
 	void EnsureStyledTo(int pos);
 	void LexerChanged();
@@ -372,6 +387,7 @@ public:
 		decorations.SetCurrentIndicator(indicator);
 	}
 	void SCI_METHOD DecorationFillRange(int position, int value, int fillLength);
+	void DecorationFillRanges(int ranges, const int *fills);
 
 	int SCI_METHOD SetLineState(int line, int state);
 	int SCI_METHOD GetLineState(int line) const;
@@ -386,6 +402,7 @@ public:
 
 	StyledText AnnotationStyledText(int line) const;
 	void AnnotationSetText(int line, const char *text);
+	void AnnotationSetTexts(int count, const int *lines, const char *texts);
 	void AnnotationSetStyle(int line, int style);
 	void AnnotationSetStyles(int line, const unsigned char *styles);
 	int AnnotationLines(int line) const;
@@ -453,6 +470,9 @@ public:
 	int foldLevelPrev;
 	int annotationLinesAdded;
 	int token;
+	int annotationLineCount;	/**< Lines changed together by AnnotationSetTexts. */
+	const int *annotationLines;
+	const int *annotationLinesAddedEach;
 
 	DocModification(int modificationType_, int position_=0, int length_=0,
 		int linesAdded_=0, const char *text_=0, int line_=0) :
@@ -465,7 +485,10 @@ public:
 		foldLevelNow(0),
 		foldLevelPrev(0),
 		annotationLinesAdded(0),
-		token(0) {}
+		token(0),
+		annotationLineCount(0),
+		annotationLines(0),
+		annotationLinesAddedEach(0) {}
 
 	DocModification(int modificationType_, const Action &act, int linesAdded_=0) :
 		modificationType(modificationType_),
@@ -477,7 +500,10 @@ public:
 		foldLevelNow(0),
 		foldLevelPrev(0),
 		annotationLinesAdded(0),
-		token(0) {}
+		token(0),
+		annotationLineCount(0),
+		annotationLines(0),
+		annotationLinesAddedEach(0) {}
 };
 
 /**
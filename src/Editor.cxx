@@ -187,6 +187,7 @@ Editor::Editor() {
 	targetStart = 0;
 	targetEnd = 0;
 	searchFlags = 0;
+	lineFilterFlags = 0;
 
 	topLine = 0;
 	posTopLine = 0;
@@ -282,6 +283,7 @@ void Editor::SetRepresentations() {
 }
 
 void Editor::DropGraphics(bool freeObjects) {
+	tileCache.Clear();
 	if (freeObjects) {
 		delete pixmapLine;
 		pixmapLine = 0;
@@ -532,6 +534,7 @@ int Editor::LineFromLocation(Point pt) const {
 
 void Editor::SetTopLine(int topLineNew) {
 	if ((topLine != topLineNew) && (topLineNew >= 0)) {
+		NeedPrefetch(topLineNew - topLine);
 		topLine = topLineNew;
 		ContainerNeedsUpdate(SC_UPDATE_V_SCROLL);
 	}
@@ -691,6 +694,7 @@ void Editor::RedrawRect(PRectangle rc) {
 
 void Editor::Redraw() {
 	//Platform::DebugPrintf("Redraw all\n");
+	tileCache.Clear();
 	PRectangle rcClient = GetClientRectangle();
 	wMain.InvalidateRectangle(rcClient);
 	if (wMargin.GetID())
@@ -698,6 +702,17 @@ void Editor::Redraw() {
 	//wMain.InvalidateAll();
 }
 
+/**
+ * Redraw everything after the view has moved without its contents changing
+ * so retained line tiles remain valid.
+ */
+void Editor::RedrawScrolled() {
+	PRectangle rcClient = GetClientRectangle();
+	wMain.InvalidateRectangle(rcClient);
+	if (wMargin.GetID())
+		wMargin.InvalidateAll();
+}
+
 void Editor::RedrawSelMargin(int line, bool allAfter) {
 	if (!AbandonPaint()) {
 		if (vs.maskInLine) {
@@ -761,6 +776,10 @@ PRectangle Editor::RectangleFromRange(int start, int end) {
 }
 
 void Editor::InvalidateRange(int start, int end) {
+	if (tileCache.Active()) {
+		tileCache.InvalidateLines(pdoc->LineFromPosition(Platform::Minimum(start, end)),
+			pdoc->LineFromPosition(Platform::Maximum(start, end)));
+	}
 	RedrawRect(RectangleFromRange(start, end));
 }
 
@@ -1081,11 +1100,11 @@ void Editor::ScrollTo(int line, bool moveThumb) {
 		if (performBlit) {
 			ScrollText(linesToMove);
 		} else {
-			Redraw();
+			RedrawScrolled();
 		}
 		willRedrawAll = false;
 #else
-		Redraw();
+		RedrawScrolled();
 #endif
 		if (moveThumb) {
 			SetVerticalScrollPos();
@@ -1095,7 +1114,7 @@ void Editor::ScrollTo(int line, bool moveThumb) {
 
 void Editor::ScrollText(int /* linesToMove */) {
 	//Platform::DebugPrintf("Editor::ScrollText %d\n", linesToMove);
-	Redraw();
+	RedrawScrolled();
 }
 
 void Editor::HorizontalScrollTo(int xPos) {
@@ -1538,7 +1557,7 @@ void Editor::SetXYScroll(XYScrollPosition newXY) {
 			}
 			SetHorizontalScrollPos();
 		}
-		Redraw();
+		RedrawScrolled();
 		UpdateSystemCaret();
 	}
 }
@@ -1703,6 +1722,70 @@ bool Editor::WrapLines(enum wrapScope ws) {
 	return wrapOccurred;
 }
 
+/**
+ * After scrolling by linesScrolled, queue the lines beyond the view in the direction
+ * of scrolling for styling and layout in idle time. Faster scrolling prefetches
+ * more screens up to layoutPrefetch.screensMax.
+ */
+void Editor::NeedPrefetch(int linesScrolled) {
+	const double secondsSinceScroll = layoutPrefetch.etScroll.Duration(true);
+	if ((layoutPrefetch.screensMax <= 0) || (linesScrolled == 0))
+		return;
+	const int linesOnScreen = Platform::Maximum(LinesOnScreen(), 1);
+	// Lines expected to be scrolled over the next half second at the current speed
+	const double linesPerSecond = abs(linesScrolled) / std::max(secondsSinceScroll, 0.01);
+	const int screens = Platform::Clamp(
+		static_cast<int>(linesPerSecond / 2.0 / linesOnScreen) + 1, 1, layoutPrefetch.screensMax);
+	const int lineDocTop = cs.DocFromDisplay(topLine + linesScrolled);
+	const int lineDocBottom = cs.DocFromDisplay(topLine + linesScrolled + linesOnScreen);
+	if (linesScrolled > 0) {
+		layoutPrefetch.direction = 1;
+		layoutPrefetch.line = lineDocBottom + 1;
+		layoutPrefetch.lineEnd = Platform::Minimum(
+			cs.DocFromDisplay(topLine + linesScrolled + (screens + 1) * linesOnScreen) + 1, pdoc->LinesTotal());
+	} else {
+		layoutPrefetch.direction = -1;
+		layoutPrefetch.line = lineDocTop - 1;
+		layoutPrefetch.lineEnd = Platform::Maximum(
+			cs.DocFromDisplay(Platform::Maximum(topLine + linesScrolled - screens * linesOnScreen, 0)) - 1, -1);
+	}
+	if (layoutPrefetch.Pending())
+		SetIdle(true);
+}
+
+/**
+ * Style and lay out one screen of the prefetch range.
+ * Layouts are only retained when the whole document is cached.
+ */
+void Editor::PrefetchLayout() {
+	const int linesSlice = Platform::Maximum(LinesOnScreen(), 1);
+	int lineFirst = layoutPrefetch.line;
+	int lineLast = layoutPrefetch.line;
+	if (layoutPrefetch.direction > 0) {
+		lineLast = Platform::Minimum(layoutPrefetch.line + linesSlice, layoutPrefetch.lineEnd) - 1;
+		layoutPrefetch.line = lineLast + 1;
+	} else {
+		lineFirst = Platform::Maximum(layoutPrefetch.line - linesSlice, layoutPrefetch.lineEnd) + 1;
+		layoutPrefetch.line = lineFirst - 1;
+	}
+	lineLast = Platform::Minimum(lineLast, pdoc->LinesTotal() - 1);
+	if (lineFirst > lineLast)
+		return;
+	pdoc->EnsureStyledTo(pdoc->LineStart(lineLast + 1));
+	if (llc.GetLevel() == LineLayoutCache::llcDocument) {
+		RefreshStyleData();
+		AutoSurface surface(this);
+		if (surface) {
+			for (int line = lineFirst; line <= lineLast; line++) {
+				if (cs.GetVisible(line)) {
+					AutoLineLayout ll(llc, RetrieveLineLayout(line));
+					LayoutLine(line, surface, vs, ll, wrapWidth);
+				}
+			}
+		}
+	}
+}
+
 void Editor::LinesJoin() {
 	if (!RangeContainsProtected(targetStart, targetEnd)) {
 		UndoGroup ug(pdoc);
@@ -2174,6 +2257,178 @@ LineLayout *Editor::RetrieveLineLayout(int lineNumber) {
 	        LinesOnScreen() + 1, pdoc->LinesTotal());
 }
 
+/**
+ * Measure the text from start to end of a line layout, with the position of start already set.
+ * Returns true if the last segment is in an italic style.
+ */
+bool Editor::LayoutSegments(Surface *surface, ViewStyle &vstyle, LineLayout *ll, int posLineStart, int start, int end) {
+	bool lastSegItalics = false;
+
+	BreakFinder bfLayout(ll, start, end, posLineStart, 0, false, pdoc, &reprs);
+	std::vector<TextSegment> segments;
+	std::vector<TextSegment> segmentsText;
+	while (bfLayout.More()) {
+		const TextSegment ts = bfLayout.Next();
+		segments.push_back(ts);
+		if (vstyle.styles[ll->styles[ts.start]].visible && !ts.representation)
+			segmentsText.push_back(ts);
+	}
+
+	// Measure all the text first so runs of segments can be measured together
+	std::fill(&ll->positions[start+1], &ll->positions[end+1], 0.0f);
+	posCache.MeasureSegments(surface, vstyle, ll->chars, ll->styles, segmentsText, ll->positions + 1, pdoc);
+
+	for (std::vector<TextSegment>::const_iterator it = segments.begin(); it != segments.end(); ++it) {
+
+		const TextSegment &ts = *it;
+
+		if (vstyle.styles[ll->styles[ts.start]].visible) {
+			if (ts.representation) {
+				XYPOSITION representationWidth = vstyle.controlCharWidth;
+				if (ll->chars[ts.start] == '\t') {
+					// Tab is a special case of representation, taking a variable amount of space
+					representationWidth =
+						((static_cast<int>((ll->positions[ts.start] + 2) / vstyle.tabWidth) + 1) * vstyle.tabWidth) - ll->positions[ts.start];
+				} else {
+					if (representationWidth <= 0.0) {
+						XYPOSITION positionsRepr[256];	// Should expand when needed
+						posCache.MeasureWidths(surface, vstyle, STYLE_CONTROLCHAR, ts.representation->stringRep.c_str(),
+							static_cast<unsigned int>(ts.representation->stringRep.length()), positionsRepr, pdoc);
+						representationWidth = positionsRepr[ts.representation->stringRep.length()-1] + vstyle.ctrlCharPadding;
+ 						}
+				}
+				for (int ii=0; ii < ts.length; ii++)
+					ll->positions[ts.start + 1 + ii] = representationWidth;
+			}
+			lastSegItalics = (!ts.representation) && ((ll->chars[ts.end()-1] != ' ') && vstyle.styles[ll->styles[ts.start]].italic);
+		} else {
+			// Platforms may write an extra element after a measured segment
+			std::fill(&ll->positions[ts.start+1], &ll->positions[ts.end()+1], 0.0f);
+		}
+
+		for (int posToIncrease = ts.start+1; posToIncrease <= ts.end(); posToIncrease++) {
+			ll->positions[posToIncrease] += ll->positions[ts.start];
+		}
+	}
+	return lastSegItalics;
+}
+
+/**
+ * Measure one chunk of a long line at the position the index currently has for it.
+ * Returns true if the chunk ends the line in an italic style.
+ */
+bool Editor::LayoutChunk(Surface *surface, ViewStyle &vstyle, LineLayout *ll, int posLineStart, int chunk) {
+	LongLineIndex &index = ll->longLine;
+	const int start = index.ChunkStart(chunk);
+	const int end = index.ChunkStart(chunk + 1);
+	ll->positions[start] = static_cast<XYPOSITION>(index.XFromChunk(chunk));
+	const bool lastSegItalics = LayoutSegments(surface, vstyle, ll, posLineStart, start, end);
+	index.SetMeasured(chunk, ll->positions[end] - ll->positions[start]);
+	return lastSegItalics && (chunk == index.Chunks() - 1);
+}
+
+static int CharactersInRange(const char *s, int start, int end, bool utf8) {
+	if (!utf8)
+		return end - start;
+	int characters = 0;
+	for (int i = start; i < end; i++) {
+		if (!UTF8IsTrailByte(static_cast<unsigned char>(s[i])))
+			characters++;
+	}
+	return characters;
+}
+
+/**
+ * Lay out a line too long to be measured completely each time it is displayed.
+ * The line is divided into chunks and only the chunks near the visible area and
+ * the caret are measured. Other chunks are spread evenly over their estimated or
+ * previously measured width so the whole line remains monotonic. Measured chunks
+ * moved by chunks measured before them are shifted, or measured again if they hold tabs.
+ * Returns true if the end of the line was measured and is in an italic style.
+ */
+bool Editor::LayoutLongLine(Surface *surface, ViewStyle &vstyle, LineLayout *ll, int line, bool keepIndex) {
+	const int posLineStart = pdoc->LineStart(line);
+	const int numCharsInLine = ll->numCharsInLine;
+	const bool utf8 = pdoc->dbcsCodePage == SC_CP_UTF8;
+	LongLineIndex &index = ll->longLine;
+	if (!keepIndex || index.Empty() || (index.ChunkStart(index.Chunks()) != numCharsInLine)) {
+		std::vector<int> starts;
+		std::vector<XYACCUMULATOR> widths;
+		int pos = 0;
+		while (pos < numCharsInLine) {
+			int posNext = Platform::Minimum(pos + LongLineIndex::lengthChunk, numCharsInLine);
+			if (posNext < numCharsInLine) {
+				posNext = Platform::Minimum(pdoc->MovePositionOutsideChar(
+					posLineStart + posNext, 1, false) - posLineStart, numCharsInLine);
+			}
+			starts.push_back(pos);
+			widths.push_back(CharactersInRange(ll->chars, pos, posNext, utf8) * vstyle.aveCharWidth);
+			pos = posNext;
+		}
+		starts.push_back(numCharsInLine);
+		index.Allocate(starts, widths);
+	}
+
+	bool lastSegItalics = false;
+	// The x each chunk was measured at or -1 when not measured in this layout
+	std::vector<XYACCUMULATOR> xMeasured(index.Chunks(), -1.0);
+	// Measure the caret chunk first as it may move the chunks after it
+	const int posCaret = sel.MainCaret() - posLineStart;
+	if ((posCaret >= 0) && (posCaret <= numCharsInLine)) {
+		const int chunkCaret = index.ChunkFromPosition(posCaret);
+		xMeasured[chunkCaret] = index.XFromChunk(chunkCaret);
+		lastSegItalics = LayoutChunk(surface, vstyle, ll, posLineStart, chunkCaret);
+	}
+	// Measure a page each side of the visible area
+	const XYACCUMULATOR widthText = GetTextRectangle().Width();
+	const XYACCUMULATOR xStart = std::max(xOffset - widthText, 0.0);
+	const XYACCUMULATOR xEnd = xOffset + 2 * widthText;
+	const int chunkFirst = index.ChunkFromX(xStart);
+	int chunkLast = chunkFirst;
+	for (int chunk = chunkFirst; (chunk < index.Chunks()) && (index.XFromChunk(chunk) <= xEnd); chunk++) {
+		if (xMeasured[chunk] < 0) {
+			xMeasured[chunk] = index.XFromChunk(chunk);
+			lastSegItalics = LayoutChunk(surface, vstyle, ll, posLineStart, chunk) || lastSegItalics;
+		}
+		chunkLast = chunk;
+	}
+	// Fill in the chunks not measured now from their widths in the index
+	for (int chunk = 0; chunk < index.Chunks(); chunk++) {
+		const int start = index.ChunkStart(chunk);
+		const int end = index.ChunkStart(chunk + 1);
+		const XYACCUMULATOR xChunk = index.XFromChunk(chunk);
+		if (xMeasured[chunk] >= 0) {
+			// Chunks before this may have changed width since it was measured
+			const XYPOSITION delta = static_cast<XYPOSITION>(xChunk - xMeasured[chunk]);
+			if (delta != 0.0f) {
+				if (memchr(ll->chars + start, '\t', end - start)) {
+					// Tab widths depend on where the chunk starts so measure it again there
+					xMeasured[chunk] = xChunk;
+					lastSegItalics = LayoutChunk(surface, vstyle, ll, posLineStart, chunk) || lastSegItalics;
+				} else {
+					for (int i = start; i <= end; i++)
+						ll->positions[i] += delta;
+				}
+			}
+		} else {
+			const int characters = CharactersInRange(ll->chars, start, end, utf8);
+			const XYACCUMULATOR step = (characters > 0) ? index.Width(chunk) / characters : 0;
+			XYACCUMULATOR x = xChunk;
+			ll->positions[start] = static_cast<XYPOSITION>(x);
+			for (int i = start; i < end; i++) {
+				if (!utf8 || !UTF8IsTrailByte(static_cast<unsigned char>(ll->chars[i])))
+					x += step;
+				ll->positions[i + 1] = static_cast<XYPOSITION>(x);
+			}
+		}
+	}
+	ll->windowed = (chunkFirst > 0) || (chunkLast < index.Chunks() - 1);
+	ll->xWindowStart = index.XFromChunk(chunkFirst);
+	ll->xWindowEnd = (chunkLast < index.Chunks() - 1) ? index.XFromChunk(chunkLast + 1) :
+		static_cast<XYPOSITION>(LineLayout::wrapWidthInfinite);
+	return lastSegItalics;
+}
+
 /**
  * Fill in the LineLayout data for the given line.
  * Copy the given @a line and its styles from the document into local arrays.
@@ -2233,6 +2488,16 @@ void Editor::LayoutLine(int line, Surface *surface, ViewStyle &vstyle, LineLayou
 			ll->validity = LineLayout::llInvalid;
 		}
 	}
+	// A long line only measured around the visible area needs remeasuring when scrolled
+	// horizontally away from that area but can keep the widths it has measured.
+	bool windowMoved = false;
+	if ((ll->validity >= LineLayout::llPositions) && ll->windowed) {
+		const PRectangle rcText = GetTextRectangle();
+		if ((xOffset < ll->xWindowStart) || ((xOffset + rcText.Width()) > ll->xWindowEnd)) {
+			windowMoved = true;
+			ll->validity = LineLayout::llInvalid;
+		}
+	}
 	if (ll->validity == LineLayout::llInvalid) {
 		ll->widthLine = LineLayout::wrapWidthInfinite;
 		ll->lines = 1;
@@ -2279,54 +2544,22 @@ void Editor::LayoutLine(int line, Surface *surface, ViewStyle &vstyle, LineLayou
 		// Layout the line, determining the position of each character,
 		// with an extra element at the end for the end of the line.
 		ll->positions[0] = 0;
+		ll->numCharsInLine = numCharsInLine;
+		ll->numCharsBeforeEOL = numCharsBeforeEOL;
 		bool lastSegItalics = false;
-
-		BreakFinder bfLayout(ll, 0, numCharsInLine, posLineStart, 0, false, pdoc, &reprs);
-		while (bfLayout.More()) {
-
-			const TextSegment ts = bfLayout.Next();
-
-			std::fill(&ll->positions[ts.start+1], &ll->positions[ts.end()+1], 0.0f);
-			if (vstyle.styles[ll->styles[ts.start]].visible) {
-				if (ts.representation) {
-					XYPOSITION representationWidth = vstyle.controlCharWidth;
-					if (ll->chars[ts.start] == '\t') {
-						// Tab is a special case of representation, taking a variable amount of space
-						representationWidth =
-							((static_cast<int>((ll->positions[ts.start] + 2) / vstyle.tabWidth) + 1) * vstyle.tabWidth) - ll->positions[ts.start];
-					} else {
-						if (representationWidth <= 0.0) {
-							XYPOSITION positionsRepr[256];	// Should expand when needed
-							posCache.MeasureWidths(surface, vstyle, STYLE_CONTROLCHAR, ts.representation->stringRep.c_str(),
-								static_cast<unsigned int>(ts.representation->stringRep.length()), positionsRepr, pdoc);
-							representationWidth = positionsRepr[ts.representation->stringRep.length()-1] + vstyle.ctrlCharPadding;
- 						}
-					}
-					for (int ii=0; ii < ts.length; ii++)
-						ll->positions[ts.start + 1 + ii] = representationWidth;
-				} else {
-					if ((ts.length == 1) && (' ' == ll->chars[ts.start])) {
-						// Over half the segments are single characters and of these about half are space characters.
-						ll->positions[ts.start + 1] = vstyle.styles[ll->styles[ts.start]].spaceWidth;
-					} else {
-						posCache.MeasureWidths(surface, vstyle, ll->styles[ts.start], ll->chars + ts.start,
-							    ts.length, ll->positions + ts.start + 1, pdoc);
-					}
-				}
-				lastSegItalics = (!ts.representation) && ((ll->chars[ts.end()-1] != ' ') && vstyle.styles[ll->styles[ts.start]].italic);
-			}
-
-			for (int posToIncrease = ts.start+1; posToIncrease <= ts.end(); posToIncrease++) {
-				ll->positions[posToIncrease] += ll->positions[ts.start];
-			}
+		if ((vstyle.longLineThreshold > 0) && (numCharsInLine > vstyle.longLineThreshold) &&
+			(width == LineLayout::wrapWidthInfinite)) {
+			lastSegItalics = LayoutLongLine(surface, vstyle, ll, line, windowMoved);
+		} else {
+			ll->windowed = false;
+			ll->longLine.Clear();
+			lastSegItalics = LayoutSegments(surface, vstyle, ll, posLineStart, 0, numCharsInLine);
 		}
 
 		// Small hack to make lines that end with italics not cut off the edge of the last character
 		if (lastSegItalics) {
 			ll->positions[numCharsInLine] += vstyle.lastSegItalicsOffset;
 		}
-		ll->numCharsInLine = numCharsInLine;
-		ll->numCharsBeforeEOL = numCharsBeforeEOL;
 		ll->validity = LineLayout::llPositions;
 	}
 	// Hard to cope when too narrow, so just assume there is space
@@ -2719,7 +2952,9 @@ void Editor::DrawIndicators(Surface *surface, ViewStyle &vsDraw, int line, int x
 		}
 	}
 
-	for (Decoration *deco = pdoc->decorations.root; deco; deco = deco->next) {
+	// Each indicator is drawn from its own runs but lines without any are skipped
+	const bool anyOnLine = pdoc->decorations.AnyOn(posLineStart + lineStart, posLineEnd);
+	for (Decoration *deco = pdoc->decorations.root; anyOnLine && deco; deco = deco->next) {
 		if (under == vsDraw.indicators[deco->indicator].under) {
 			int startPos = posLineStart + lineStart;
 			if (!deco->rs.ValueAt(startPos)) {
@@ -3630,6 +3865,8 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 		//double durCopy = 0.0;
 		//ElapsedTime etWhole;
 		int lineDocPrevious = -1;	// Used to avoid laying out one document line multiple times
+		// Retained tiles are only possible when each line is drawn separately into pixmapLine
+		const bool retainTiles = tileCache.Active() && bufferedDraw;
 		AutoLineLayout ll(llc, 0);
 		while (visibleLine < cs.LinesDisplayed() && yposScreen < rcArea.bottom) {
 
@@ -3639,6 +3876,21 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 			int lineStartSet = cs.DisplayFromDoc(lineDoc);
 			int subLine = visibleLine - lineStartSet;
 
+			PRectangle rcCopyArea(vs.textStart-leftTextOverlap, yposScreen,
+				rcClient.right - vs.rightMarginWidth, yposScreen + vs.lineHeight);
+			if (retainTiles) {
+				const LineTile *tile = tileCache.Find(lineDoc, subLine, xOffset,
+					rcCopyArea.Width(), vs.lineHeight);
+				if (tile) {
+					// Rendered line is still valid so just copy it to the window
+					surfaceWindow->Copy(rcCopyArea, Point(0, 0), *tile->surface);
+					lineWidthMaxSeen = Platform::Maximum(lineWidthMaxSeen, tile->widthLine);
+					yposScreen += vs.lineHeight;
+					visibleLine++;
+					continue;
+				}
+			}
+
 			// Copy this line and its styles from the document into local arrays
 			// and determine the x position at which each character starts.
 			//ElapsedTime et;
@@ -3713,9 +3965,16 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 
 				if (bufferedDraw) {
 					Point from(vs.textStart-leftTextOverlap, 0);
-					PRectangle rcCopyArea(vs.textStart-leftTextOverlap, yposScreen,
-					        rcClient.right - vs.rightMarginWidth, yposScreen + vs.lineHeight);
 					surfaceWindow->Copy(rcCopyArea, from, *pixmapLine);
+					if (retainTiles) {
+						Surface *surfaceTile = tileCache.Store(lineDoc, subLine, xOffset,
+							rcCopyArea.Width(), vs.lineHeight, ll->positions[ll->numCharsInLine],
+							surfaceWindow, wMain.GetID(), technology);
+						if (surfaceTile) {
+							surfaceTile->Copy(PRectangle(0, 0, rcCopyArea.Width(), vs.lineHeight),
+								from, *pixmapLine);
+						}
+					}
 				}
 
 				lineWidthMaxSeen = Platform::Maximum(
@@ -3733,6 +3992,12 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 			//gdk_flush();
 		}
 		ll.Set(0);
+		if (retainTiles) {
+			// Keep tiles for the lines on screen and a page either side
+			const int linesOnScreen = LinesOnScreen();
+			tileCache.Trim(cs.DocFromDisplay(Platform::Maximum(TopLineOfMain() - linesOnScreen, 0)),
+				cs.DocFromDisplay(TopLineOfMain() + 2 * linesOnScreen));
+		}
 		//if (durPaint < 0.00000001)
 		//	durPaint = 0.00000001;
 
@@ -3794,6 +4059,8 @@ long Editor::FormatRange(bool draw, Sci_RangeToFormat *pfr) {
 
 	ViewStyle vsPrint(vs);
 	vsPrint.technology = SC_TECHNOLOGY_DEFAULT;
+	// Printed lines are always laid out completely
+	vsPrint.longLineThreshold = 0;
 
 	// Modify the view style for printing as do not normally want any of the transient features to be printed
 	// Printing supports only the line number margin.
@@ -4648,6 +4915,25 @@ static inline int MovePositionForDeletion(int position, int startDeletion, int l
 
 void Editor::NotifyModified(Document *, DocModification mh, void *) {
 	ContainerNeedsUpdate(SC_UPDATE_CONTENT);
+	if (mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) {
+		// Line numbers of prefetch range no longer valid
+		layoutPrefetch.Reset();
+	}
+	if (tileCache.Active()) {
+		if ((mh.linesAdded != 0) || (mh.modificationType & SC_MOD_CHANGEANNOTATION)) {
+			// Line numbers or heights change so tiles are no longer aligned with lines
+			tileCache.Clear();
+		} else if ((mh.modificationType & SC_MOD_CHANGEMARKER) && (mh.line < 0)) {
+			// Markers changed on many lines
+			tileCache.Clear();
+		} else if (mh.modificationType & (SC_MOD_CHANGEMARKER | SC_MOD_CHANGEFOLD | SC_MOD_CHANGELINESTATE)) {
+			// Fold level changes may alter the fold line drawn under the previous line
+			tileCache.InvalidateLines(mh.line - 1, mh.line);
+		} else {
+			tileCache.InvalidateLines(pdoc->LineFromPosition(mh.position),
+				pdoc->LineFromPosition(mh.position + mh.length));
+		}
+	}
 	if (paintState == painting) {
 		CheckForChangeOutsidePaint(Range(mh.position, mh.position + mh.length));
 	}
@@ -4727,11 +5013,37 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 		if (mh.modificationType & SC_MOD_CHANGEANNOTATION) {
 			int lineDoc = pdoc->LineFromPosition(mh.position);
 			if (vs.annotationVisible) {
-				cs.SetHeight(lineDoc, cs.GetHeight(lineDoc) + mh.annotationLinesAdded);
+				if (mh.annotationLineCount > 0) {
+					// Annotations set on many lines at once so adjust only the lines listed
+					for (int i = 0; i < mh.annotationLineCount; i++) {
+						const int line = mh.annotationLines[i];
+						cs.SetHeight(line, cs.GetHeight(line) + mh.annotationLinesAddedEach[i]);
+					}
+					SetScrollBars();
+				} else {
+					cs.SetHeight(lineDoc, cs.GetHeight(lineDoc) + mh.annotationLinesAdded);
+				}
 				Redraw();
 			}
 		}
 		CheckModificationForWrap(mh);
+		if (!lineFilter.empty() && (mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))) {
+			// The changed lines may have started or stopped matching the filter
+			int lineStart = pdoc->LineFromPosition(mh.position);
+			int lineEnd = (mh.modificationType & SC_MOD_INSERTTEXT) ?
+				pdoc->LineFromPosition(mh.position + mh.length) : lineStart;
+			bool changedVisibility = FilterLines(lineStart, lineEnd + 1);
+			// Editing the caret line so it no longer matches should not hide the caret
+			const int lineCaret = pdoc->LineFromPosition(sel.MainCaret());
+			if (!cs.GetVisible(lineCaret)) {
+				cs.SetVisible(lineCaret, lineCaret, true);
+				changedVisibility = true;
+			}
+			if (changedVisibility && !CanDeferToLastStep(mh)) {
+				SetScrollBars();
+				Redraw();
+			}
+		}
 		if (mh.linesAdded != 0) {
 			// Avoid scrolling of display if change before current display
 			if (mh.position < posTopLine && !CanDeferToLastStep(mh)) {
@@ -6747,12 +7059,20 @@ bool Editor::Idle() {
 			wrappingDone = true;
 	}
 
+	bool prefetchDone = !layoutPrefetch.Pending();
+
+	if (!prefetchDone) {
+		// Prepare lines about to be scrolled into view
+		PrefetchLayout();
+		prefetchDone = !layoutPrefetch.Pending();
+	}
+
 	// Add more idle things to do here, but make sure idleDone is
 	// set correctly before the function returns. returning
 	// false will stop calling this idle funtion until SetIdle() is
 	// called again.
 
-	idleDone = wrappingDone; // && thatDone && theOtherThingDone...
+	idleDone = wrappingDone && prefetchDone; // && thatDone && theOtherThingDone...
 
 	return !idleDone;
 }
@@ -6851,6 +7171,16 @@ void Editor::CheckForChangeOutsidePaint(Range r) {
 
 void Editor::SetBraceHighlight(Position pos0, Position pos1, int matchStyle) {
 	if ((pos0 != braces[0]) || (pos1 != braces[1]) || (matchStyle != bracesMatchStyle)) {
+		if (tileCache.Active()) {
+			// Often called while painting where retained tiles would otherwise be copied unchanged
+			const Position positions[] = { braces[0], braces[1], pos0, pos1 };
+			for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+				if (positions[i] >= 0) {
+					const int lineBrace = pdoc->LineFromPosition(positions[i]);
+					tileCache.InvalidateLines(lineBrace, lineBrace);
+				}
+			}
+		}
 		if ((braces[0] != pos0) || (matchStyle != bracesMatchStyle)) {
 			CheckForChangeOutsidePaint(Range(braces[0]));
 			CheckForChangeOutsidePaint(Range(pos0));
@@ -6917,6 +7247,7 @@ void Editor::SetDocPointer(Document *document) {
 	cs.Clear();
 	cs.InsertLines(0, pdoc->LinesTotal() - 1);
 	SetAnnotationHeights(0, pdoc->LinesTotal());
+	FilterLines(0, pdoc->LinesTotal());
 	llc.Deallocate();
 	NeedWrapping();
 
@@ -6999,7 +7330,8 @@ void Editor::FoldLine(int line, int action) {
 				GoToLine(line);
 			}
 			cs.SetExpanded(line, 1);
-			ExpandLine(line);
+			const int lineMaxSubord = ExpandLine(line);
+			FilterLines(line + 1, lineMaxSubord + 1, false);
 		}
 
 		SetScrollBars();
@@ -7019,12 +7351,11 @@ void Editor::FoldExpand(int line, int action, int level) {
 	int lineMaxSubord = pdoc->GetLastChild(line, level & SC_FOLDLEVELNUMBERMASK);
 	line++;
 	cs.SetVisible(line, lineMaxSubord, expanding);
-	while (line <= lineMaxSubord) {
-		int levelLine = pdoc->GetLevel(line);
-		if (levelLine & SC_FOLDLEVELHEADERFLAG) {
-			SetFoldExpanded(line, expanding);
-		}
-		line++;
+	if (expanding)
+		FilterLines(line, lineMaxSubord + 1, false);
+	for (line = pdoc->FoldHeaderNext(line); (line >= 0) && (line <= lineMaxSubord);
+		line = pdoc->FoldHeaderNext(line + 1)) {
+		SetFoldExpanded(line, expanding);
 	}
 	SetScrollBars();
 	Redraw();
@@ -7104,26 +7435,23 @@ void Editor::FoldAll(int action) {
 	bool expanding = action == SC_FOLDACTION_EXPAND;
 	if (action == SC_FOLDACTION_TOGGLE) {
 		// Discover current state
-		for (int lineSeek = 0; lineSeek < maxLine; lineSeek++) {
-			if (pdoc->GetLevel(lineSeek) & SC_FOLDLEVELHEADERFLAG) {
-				expanding = !cs.GetExpanded(lineSeek);
-				break;
-			}
+		int lineSeek = pdoc->FoldHeaderNext(0);
+		if (lineSeek >= 0) {
+			expanding = !cs.GetExpanded(lineSeek);
 		}
 	}
 	if (expanding) {
 		cs.SetVisible(0, maxLine-1, true);
-		for (int line = 0; line < maxLine; line++) {
-			int levelLine = pdoc->GetLevel(line);
-			if (levelLine & SC_FOLDLEVELHEADERFLAG) {
-				SetFoldExpanded(line, true);
-			}
+		FilterLines(0, maxLine, false);
+		for (int line = pdoc->FoldHeaderNext(0); line >= 0; line = pdoc->FoldHeaderNext(line + 1)) {
+			SetFoldExpanded(line, true);
 		}
 	} else {
-		for (int line = 0; line < maxLine; line++) {
+		// Only top level fold headers are contracted
+		for (int line = pdoc->FoldHeaderNext(0, SC_FOLDLEVELBASE); line >= 0;
+			line = pdoc->FoldHeaderNext(line + 1, SC_FOLDLEVELBASE)) {
 			int level = pdoc->GetLevel(line);
-			if ((level & SC_FOLDLEVELHEADERFLAG) &&
-					(SC_FOLDLEVELBASE == (level & SC_FOLDLEVELNUMBERMASK))) {
+			if (SC_FOLDLEVELBASE == (level & SC_FOLDLEVELNUMBERMASK)) {
 				SetFoldExpanded(line, false);
 				int lineMaxSubord = pdoc->GetLastChild(line, -1);
 				if (lineMaxSubord > line) {
@@ -7136,6 +7464,77 @@ void Editor::FoldAll(int action) {
 	Redraw();
 }
 
+/**
+ * Show the lines from lineStart up to lineEnd that contain a match for the line filter
+ * and hide the others. Each match skips to the next line so the lines are examined in one
+ * pass and the runs of lines to show or hide are then applied together.
+ * When showMatches is false only the other lines are hidden, so matching lines inside
+ * contracted folds stay hidden after folds are expanded.
+ * Returns true if the visibility of any line changed.
+ */
+bool Editor::FilterLines(int lineStart, int lineEnd, bool showMatches) {
+	if (lineFilter.empty())
+		return false;
+	if (!pdoc->HasCaseFolder())
+		pdoc->SetCaseFolder(CaseFolderForEncoding());
+	lineStart = Platform::Maximum(lineStart, 0);
+	lineEnd = Platform::Minimum(lineEnd, pdoc->LinesTotal());
+	const int posEnd = pdoc->LineStart(lineEnd);
+	std::vector<int> linesVisible;	// (line, count, visible) triples
+	int lineShow = -1;	// Start of a run of matching lines not yet added
+	int line = lineStart;
+	while (line < lineEnd) {
+		int lengthFound = static_cast<int>(lineFilter.length());
+		int pos = pdoc->FindText(pdoc->LineStart(line), posEnd, lineFilter.c_str(),
+		        (lineFilterFlags & SCFIND_MATCHCASE) != 0,
+		        (lineFilterFlags & SCFIND_WHOLEWORD) != 0,
+		        (lineFilterFlags & SCFIND_WORDSTART) != 0,
+		        (lineFilterFlags & SCFIND_REGEXP) != 0,
+		        lineFilterFlags,
+		        &lengthFound);
+		int lineMatch = (pos < 0) ? lineEnd : Platform::Minimum(pdoc->LineFromPosition(pos), lineEnd);
+		if (lineMatch > line) {
+			if ((lineShow >= 0) && showMatches) {
+				linesVisible.push_back(lineShow);
+				linesVisible.push_back(line - lineShow);
+				linesVisible.push_back(1);
+				lineShow = -1;
+			}
+			// The first line can not be hidden
+			int lineHide = Platform::Maximum(line, 1);
+			if (lineHide < lineMatch) {
+				linesVisible.push_back(lineHide);
+				linesVisible.push_back(lineMatch - lineHide);
+				linesVisible.push_back(0);
+			}
+		}
+		if ((lineMatch < lineEnd) && (lineShow < 0)) {
+			lineShow = lineMatch;
+		}
+		line = lineMatch + 1;
+	}
+	if ((lineShow >= 0) && showMatches) {
+		linesVisible.push_back(lineShow);
+		linesVisible.push_back(lineEnd - lineShow);
+		linesVisible.push_back(1);
+	}
+	if (linesVisible.empty())
+		return false;
+	return cs.SetVisibleRanges(static_cast<int>(linesVisible.size() / 3), &linesVisible[0]);
+}
+
+void Editor::SetLineFilter(int flags, const char *text) {
+	lineFilter = text ? text : "";
+	lineFilterFlags = flags;
+	if (lineFilter.empty()) {
+		cs.SetVisible(0, pdoc->LinesTotal() - 1, true);
+	} else {
+		FilterLines(0, pdoc->LinesTotal());
+	}
+	SetScrollBars();
+	Redraw();
+}
+
 void Editor::FoldChanged(int line, int levelNow, int levelPrev) {
 	if (levelNow & SC_FOLDLEVELHEADERFLAG) {
 		if (!(levelPrev & SC_FOLDLEVELHEADERFLAG)) {
@@ -7162,6 +7561,7 @@ void Editor::FoldChanged(int line, int levelNow, int levelPrev) {
 			int parentLine = pdoc->GetFoldParent(line);
 			if ((parentLine < 0) || (cs.GetExpanded(parentLine) && cs.GetVisible(parentLine))) {
 				cs.SetVisible(line, line, true);
+				FilterLines(line, line + 1, false);
 				SetScrollBars();
 				Redraw();
 			}
@@ -8034,6 +8434,14 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETBUFFEREDDRAW:
 		return bufferedDraw;
 
+	case SCI_SETRETAINEDDRAW:
+		tileCache.SetActive(wParam != 0);
+		Redraw();
+		break;
+
+	case SCI_GETRETAINEDDRAW:
+		return tileCache.Active();
+
 	case SCI_GETTWOPHASEDRAW:
 		return twoPhaseDraw;
 
@@ -8179,6 +8587,34 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETLAYOUTCACHE:
 		return llc.GetLevel();
 
+	case SCI_SETLAYOUTCACHEMEMORY:
+		llc.SetMemoryLimit(wParam);
+		break;
+
+	case SCI_GETLAYOUTCACHEMEMORY:
+		return llc.GetMemoryLimit();
+
+	case SCI_GETLAYOUTCACHEMEMORYUSED:
+		return llc.MemoryUsed();
+
+	case SCI_SETLAYOUTPREFETCH:
+		layoutPrefetch.screensMax = static_cast<int>(wParam);
+		layoutPrefetch.Reset();
+		break;
+
+	case SCI_GETLAYOUTPREFETCH:
+		return layoutPrefetch.screensMax;
+
+	case SCI_SETLONGLINETHRESHOLD:
+		if (vs.longLineThreshold != static_cast<int>(wParam)) {
+			vs.longLineThreshold = static_cast<int>(wParam);
+			InvalidateStyleRedraw();
+		}
+		break;
+
+	case SCI_GETLONGLINETHRESHOLD:
+		return vs.longLineThreshold;
+
 	case SCI_SETPOSITIONCACHE:
 		posCache.SetSize(wParam);
 		break;
@@ -8373,6 +8809,16 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 			pdoc->AddMarkSet(wParam, lParam);
 		break;
 
+	case SCI_MARKERADDMANY:
+		if (lParam == 0)
+			return -1;
+		return pdoc->AddMarks(wParam, reinterpret_cast<const int *>(lParam));
+
+	case SCI_MARKERDELETEMANY:
+		if (lParam != 0)
+			pdoc->DeleteMarks(wParam, reinterpret_cast<const int *>(lParam));
+		break;
+
 	case SCI_MARKERDELETE:
 		pdoc->DeleteMark(wParam, lParam);
 		break;
@@ -8387,13 +8833,8 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_MARKERNEXT:
 		return pdoc->MarkerNext(wParam, lParam);
 
-	case SCI_MARKERPREVIOUS: {
-			for (int iLine = wParam; iLine >= 0; iLine--) {
-				if ((pdoc->GetMark(iLine) & lParam) != 0)
-					return iLine;
-			}
-		}
-		return -1;
+	case SCI_MARKERPREVIOUS:
+		return pdoc->MarkerPrevious(wParam, lParam);
 
 	case SCI_MARKERDEFINEPIXMAP:
 		if (wParam <= MARKER_MAX) {
@@ -8622,6 +9063,13 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETLINEVISIBLE:
 		return cs.GetVisible(wParam);
 
+	case SCI_SETLINEFILTER:
+		SetLineFilter(wParam, CharPtrFromSPtr(lParam));
+		break;
+
+	case SCI_GETLINEFILTER:
+		return StringResult(lParam, lineFilter.c_str());
+
 	case SCI_GETALLLINESVISIBLE:
 		return cs.HiddenLines() ? 0 : 1;
 
@@ -8860,6 +9308,11 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->DecorationFillRange(wParam, 0, lParam);
 		break;
 
+	case SCI_INDICATORFILLRANGES:
+		if (lParam != 0)
+			pdoc->DecorationFillRanges(wParam, reinterpret_cast<const int *>(lParam));
+		break;
+
 	case SCI_INDICATORALLONFOR:
 		return pdoc->decorations.AllOnFor(wParam);
 
@@ -9345,6 +9798,13 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->AnnotationSetText(wParam, CharPtrFromSPtr(lParam));
 		break;
 
+	case SCI_ANNOTATIONSETTEXTMANY:
+		if (lParam) {
+			const int *lines = reinterpret_cast<const int *>(lParam);
+			pdoc->AnnotationSetTexts(wParam, lines, reinterpret_cast<const char *>(lines + wParam));
+		}
+		break;
+
 	case SCI_ANNOTATIONGETTEXT: {
 			const StyledText st = pdoc->AnnotationStyledText(wParam);
 			if (lParam) {
@@ -160,6 +160,27 @@ struct WrapPending {
 	}
 };
 
+/**
+ * Lines to be styled and laid out during idle time ahead of scrolling.
+ * Lines are visited from line towards lineEnd in direction.
+ */
+struct LayoutPrefetch {
+	int screensMax;	// 0 turns prefetching off
+	int line;
+	int lineEnd;
+	int direction;
+	ElapsedTime etScroll;
+	LayoutPrefetch() : screensMax(0), line(0), lineEnd(0), direction(1) {
+	}
+	void Reset() {
+		line = 0;
+		lineEnd = 0;
+	}
+	bool Pending() const {
+		return (direction > 0) ? (line < lineEnd) : (line > lineEnd);
+	}
+};
+
 struct PrintParameters {
 	int magnification;
 	int colourMode;
@@ -237,6 +258,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	LineLayoutCache llc;
 	PositionCache posCache;
+	LineTileCache tileCache;
 	SpecialRepresentations reprs;
 
 	KeyMap kmap;
@@ -269,6 +291,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	int targetStart;
 	int targetEnd;
 	int searchFlags;
+	std::string lineFilter;	///< Only lines containing a match are shown when not empty
+	int lineFilterFlags;
 	int topLine;
 	int posTopLine;
 	int lengthForEncode;
@@ -316,6 +340,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	int wrapWidth;
 	WrapPending wrapPending;
 
+	LayoutPrefetch layoutPrefetch;
+
 	bool convertPastes;
 
 	Document *pdoc;
@@ -358,6 +384,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	bool AbandonPaint();
 	void RedrawRect(PRectangle rc);
 	void Redraw();
+	void RedrawScrolled();
 	void RedrawSelMargin(int line=-1, bool allAfter=false);
 	PRectangle RectangleFromRange(int start, int end);
 	void InvalidateRange(int start, int end);
@@ -426,12 +453,17 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	bool WrapOneLine(Surface *surface, int lineToWrap);
 	enum wrapScope {wsAll, wsVisible, wsIdle};
 	bool WrapLines(enum wrapScope ws);
+	void NeedPrefetch(int linesScrolled);
+	void PrefetchLayout();
 	void LinesJoin();
 	void LinesSplit(int pixelWidth);
 
 	int SubstituteMarkerIfEmpty(int markerCheck, int markerDefault) const;
 	void PaintSelMargin(Surface *surface, PRectangle &rc);
 	LineLayout *RetrieveLineLayout(int lineNumber);
+	bool LayoutSegments(Surface *surface, ViewStyle &vstyle, LineLayout *ll, int posLineStart, int start, int end);
+	bool LayoutChunk(Surface *surface, ViewStyle &vstyle, LineLayout *ll, int posLineStart, int chunk);
+	bool LayoutLongLine(Surface *surface, ViewStyle &vstyle, LineLayout *ll, int line, bool keepIndex);
 	void LayoutLine(int line, Surface *surface, ViewStyle &vstyle, LineLayout *ll,
 		int width=LineLayout::wrapWidthInfinite);
 	ColourDesired SelectionBackground(ViewStyle &vsDraw, bool main) const;
@@ -603,6 +635,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void FoldChanged(int line, int levelNow, int levelPrev);
 	void NeedShown(int pos, int len);
 	void FoldAll(int action);
+	bool FilterLines(int lineStart, int lineEnd, bool showMatches=true);
+	void SetLineFilter(int flags, const char *text);
 
 	int GetTag(char *tagValue, int tagNumber);
 	int ReplaceTarget(bool replacePatterns, const char *text, int length=-1);
@@ -109,6 +109,15 @@ public:
 		stepPartition++;
 	}
 
+	/// Insert count partitions starting at partition with a single gap move.
+	void InsertPartitions(int partition, const int *positions, int count) {
+		if (stepPartition < partition) {
+			ApplyStep(partition);
+		}
+		body->InsertFromArray(partition, positions, 0, count);
+		stepPartition += count;
+	}
+
 	void SetPartitionStartPosition(int partition, int pos) {
 		ApplyStep(partition+1);
 		if ((partition < 0) || (partition > body->Length())) {
@@ -139,6 +148,25 @@ public:
 		}
 	}
 
+	/// Change the length of each of partitionCount partitions from partitionStart by delta.
+	/// This is the same as calling InsertText(partition, delta) for each partition but moves
+	/// the following partitions just once.
+	void InsertTextEach(int partitionStart, int partitionCount, int delta) {
+		if ((partitionCount <= 0) || (delta == 0))
+			return;
+		const int partitionLast = partitionStart + partitionCount - 1;
+		if (stepPartition < partitionLast + 1) {
+			ApplyStep(partitionLast + 1);
+		}
+		// Partitions up to the step hold their real positions so can be changed directly
+		int shift = 0;
+		for (int partition = partitionStart + 1; partition <= partitionLast; partition++) {
+			shift += delta;
+			body->SetValueAt(partition, body->ValueAt(partition) + shift);
+		}
+		InsertText(partitionLast, shift + delta);
+	}
+
 	void RemovePartition(int partition) {
 		if (partition > stepPartition) {
 			ApplyStep(partition);
@@ -7,7 +7,9 @@
 
 #include <string.h>
 
+#include <vector>
 #include <algorithm>
+#include <map>
 
 #include "Platform.h"
 
@@ -23,6 +25,7 @@ using namespace Scintilla;
 
 MarkerHandleSet::MarkerHandleSet() {
 	root = 0;
+	index = 0;
 }
 
 MarkerHandleSet::~MarkerHandleSet() {
@@ -115,60 +118,250 @@ void MarkerHandleSet::CombineWith(MarkerHandleSet *other) {
 	other->root = 0;
 }
 
+LineMarkers::LineMarkers() :
+	lines(32), indexValid(0), handleCurrent(0), treeLeaves(0), treeValid(false), setsScanned(0) {
+	Init();
+}
+
 LineMarkers::~LineMarkers() {
 	Init();
 }
 
 void LineMarkers::Init() {
-	for (int line = 0; line < markers.Length(); line++) {
-		delete markers[line];
-		markers[line] = 0;
+	for (int index = 0; index < sets.Length(); index++) {
+		delete sets[index];
+		sets[index] = 0;
+	}
+	sets.DeleteAll();
+	values.DeleteAll();
+	handles.clear();
+	lines.DeleteAll();
+	// Keep the end of the last partition beyond every line
+	lines.InsertText(0, 0x40000000);
+	indexValid = 0;
+	for (int number = 0; number <= MARKER_MAX; number++)
+		numberCounts[number] = 0;
+	InvalidateTree();
+}
+
+int LineMarkers::LineOfSet(int index) const {
+	return lines.PositionFromPartition(index + 1) - 1;
+}
+
+/// Index of the first set on line or after it.
+int LineMarkers::SetFromLine(int line) const {
+	// Partition p is the last one starting at or before line + 1 so set p-1 is the last set
+	// on or before line.
+	const int partition = lines.PartitionFromPosition(line + 1);
+	if ((partition > 0) && (LineOfSet(partition - 1) == line))
+		return partition - 1;
+	return partition;
+}
+
+void LineMarkers::InsertSet(int index, int line) {
+	lines.InsertPartition(index + 1, line + 1);
+	MarkerHandleSet *set = new MarkerHandleSet();
+	set->index = index;
+	sets.Insert(index, set);
+	values.Insert(index, 0);
+	if (index < indexValid)
+		indexValid = index;
+	if (index == indexValid)
+		indexValid++;
+	// A set added at the end takes an empty leaf so the tree stays valid
+	if ((index < sets.Length() - 1) || (index >= treeLeaves))
+		InvalidateTree();
+}
+
+void LineMarkers::RemoveSet(int index, bool forget) {
+	if (forget)
+		Forget(sets[index]->First());
+	delete sets[index];
+	sets.Delete(index);
+	values.Delete(index);
+	lines.RemovePartition(index + 1);
+	if (index < indexValid)
+		indexValid = index;
+	if (index < sets.Length()) {
+		InvalidateTree();
+	} else if (treeValid) {
+		// Clear the leaf of the last set so it can be taken again
+		treeValues[treeLeaves + index] = 0;
+		for (int node = (treeLeaves + index) / 2; node > 0; node /= 2)
+			treeValues[node] = treeValues[node * 2] | treeValues[node * 2 + 1];
 	}
-	markers.DeleteAll();
 }
 
-void LineMarkers::InsertLine(int line) {
-	if (markers.Length()) {
-		markers.Insert(line, 0);
+/// Drop the handles in a list that is about to be deleted.
+void LineMarkers::Forget(const MarkerHandleNumber *mhn) {
+	for (; mhn; mhn = mhn->next) {
+		handles.erase(mhn->handle);
+		numberCounts[mhn->number]--;
 	}
 }
 
+void LineMarkers::SetValue(int index, int value) {
+	values[index] = value;
+	if (treeValid) {
+		int node = treeLeaves + index;
+		treeValues[node] = value;
+		for (node /= 2; node > 0; node /= 2)
+			treeValues[node] = treeValues[node * 2] | treeValues[node * 2 + 1];
+	}
+}
+
+void LineMarkers::BuildTree() const {
+	// Leaves start at treeLeaves with room for a set to be added and each node holds
+	// the union of its two children
+	treeLeaves = 1;
+	while (treeLeaves <= sets.Length())
+		treeLeaves *= 2;
+	treeValues.assign(treeLeaves * 2, 0);
+	for (int index = 0; index < sets.Length(); index++)
+		treeValues[treeLeaves + index] = values[index];
+	for (int node = treeLeaves - 1; node > 0; node--)
+		treeValues[node] = treeValues[node * 2] | treeValues[node * 2 + 1];
+	treeValid = true;
+}
+
+void LineMarkers::InvalidateTree() {
+	treeValid = false;
+	setsScanned = 0;
+}
+
+/// Index of the first set from index onwards with any marker in mask or -1 if there is none.
+int LineMarkers::FirstSetWith(int index, int mask) const {
+	const int length = sets.Length();
+	const int indexEndScan = std::min(length, index + lengthScan);
+	for (; index < indexEndScan; index++) {
+		if (values[index] & mask)
+			return index;
+	}
+	if (!treeValid) {
+		// Rebuild only once scanning has cost as much as rebuilding
+		for (; (index < length) && (setsScanned < length); index++, setsScanned++) {
+			if (values[index] & mask)
+				return index;
+		}
+		if (index < length)
+			BuildTree();
+	}
+	if (index >= length)
+		return -1;
+	int node = treeLeaves + index;
+	while (!(treeValues[node] & mask)) {
+		// Climb while a right child then move to the following subtree
+		while (node & 1)
+			node /= 2;
+		if (node == 0)
+			return -1;
+		node++;
+	}
+	while (node < treeLeaves) {
+		node *= 2;
+		if (!(treeValues[node] & mask))
+			node++;
+	}
+	return node - treeLeaves;
+}
+
+/// Index of the last set from index back to the start with any marker in mask or -1 if there is none.
+int LineMarkers::LastSetWith(int index, int mask) const {
+	const int indexStartScan = std::max(index - lengthScan, -1);
+	for (; index > indexStartScan; index--) {
+		if (values[index] & mask)
+			return index;
+	}
+	if (!treeValid) {
+		for (; (index >= 0) && (setsScanned < sets.Length()); index--, setsScanned++) {
+			if (values[index] & mask)
+				return index;
+		}
+		if (index >= 0)
+			BuildTree();
+	}
+	if (index < 0)
+		return -1;
+	int node = treeLeaves + index;
+	while (!(treeValues[node] & mask)) {
+		// Climb while a left child then move to the preceding subtree
+		while ((node > 1) && !(node & 1))
+			node /= 2;
+		if (node == 1)
+			return -1;
+		node--;
+	}
+	while (node < treeLeaves) {
+		node = node * 2 + 1;
+		if (!(treeValues[node] & mask))
+			node--;
+	}
+	return node - treeLeaves;
+}
+
+bool LineMarkers::AnyOf(int mask) const {
+	unsigned int m = mask;
+	for (int number = 0; m; number++, m >>= 1) {
+		if ((m & 1) && numberCounts[number])
+			return true;
+	}
+	return false;
+}
+
+void LineMarkers::InsertLine(int line) {
+	lines.InsertText(SetFromLine(line), 1);
+}
+
+void LineMarkers::InsertLines(int line, int lineCount) {
+	lines.InsertText(SetFromLine(line), lineCount);
+}
+
 void LineMarkers::RemoveLine(int line) {
 	// Retain the markers from the deleted line by oring them into the previous line
-	if (markers.Length()) {
-		if (line > 0) {
+	int index = SetFromLine(line);
+	if ((index < sets.Length()) && (LineOfSet(index) == line)) {
+		if (line == 0) {
+			RemoveSet(index, true);
+		} else if ((index > 0) && (LineOfSet(index - 1) == line - 1)) {
 			MergeMarkers(line - 1);
 		}
-		markers.Delete(line);
+		// Otherwise the set moves up to the previous line along with the following sets
 	}
+	lines.InsertText(index, -1);
 }
 
 int LineMarkers::LineFromHandle(int markerHandle) {
-	if (markers.Length()) {
-		for (int line = 0; line < markers.Length(); line++) {
-			if (markers[line]) {
-				if (markers[line]->Contains(markerHandle)) {
-					return line;
-				}
-			}
-		}
+	HandleMap::const_iterator it = handles.find(markerHandle);
+	if (it == handles.end())
+		return -1;
+	MarkerHandleSet *set = it->second;
+	if ((set->index >= indexValid) || (sets[set->index] != set)) {
+		for (; indexValid < sets.Length(); indexValid++)
+			sets[indexValid]->index = indexValid;
 	}
-	return -1;
+	return LineOfSet(set->index);
 }
 
 void LineMarkers::MergeMarkers(int pos) {
-	if (markers[pos + 1] != NULL) {
-		if (markers[pos] == NULL)
-			markers[pos] = new MarkerHandleSet;
-		markers[pos]->CombineWith(markers[pos + 1]);
-		delete markers[pos + 1];
-		markers[pos + 1] = NULL;
+	const int index = SetFromLine(pos + 1);
+	if ((index < sets.Length()) && (LineOfSet(index) == pos + 1)) {
+		if ((index == 0) || (LineOfSet(index - 1) != pos)) {
+			lines.SetPartitionStartPosition(index + 1, pos + 1);
+			return;
+		}
+		MarkerHandleSet *set = sets[index - 1];
+		for (const MarkerHandleNumber *mhn = sets[index]->First(); mhn; mhn = mhn->next)
+			handles[mhn->handle] = set;
+		set->CombineWith(sets[index]);
+		SetValue(index - 1, values[index - 1] | values[index]);
+		RemoveSet(index, false);
 	}
 }
 
 int LineMarkers::MarkValue(int line) {
-	if (markers.Length() && (line >= 0) && (line < markers.Length()) && markers[line])
-		return markers[line]->MarkValue();
+	const int index = SetFromLine(line);
+	if ((index < sets.Length()) && (LineOfSet(index) == line))
+		return values[index];
 	else
 		return 0;
 }
@@ -176,46 +369,86 @@ int LineMarkers::MarkValue(int line) {
 int LineMarkers::MarkerNext(int lineStart, int mask) const {
 	if (lineStart < 0)
 		lineStart = 0;
-	int length = markers.Length();
-	for (int iLine = lineStart; iLine < length; iLine++) {
-		MarkerHandleSet *onLine = markers[iLine];
-		if (onLine && ((onLine->MarkValue() & mask) != 0))
-		//if ((pdoc->GetMark(iLine) & lParam) != 0)
-			return iLine;
+	if (AnyOf(mask)) {
+		const int index = FirstSetWith(SetFromLine(lineStart), mask);
+		if (index >= 0)
+			return LineOfSet(index);
 	}
 	return -1;
 }
 
-int LineMarkers::AddMark(int line, int markerNum, int lines) {
-	handleCurrent++;
-	if (!markers.Length()) {
-		// No existing markers so allocate one element per line
-		markers.InsertValue(0, lines, 0);
+int LineMarkers::MarkerPrevious(int lineStart, int mask) const {
+	if ((lineStart >= 0) && AnyOf(mask)) {
+		// Sets before the first one after lineStart
+		const int index = LastSetWith(SetFromLine(lineStart + 1) - 1, mask);
+		if (index >= 0)
+			return LineOfSet(index);
 	}
-	if (line >= markers.Length()) {
+	return -1;
+}
+
+int LineMarkers::AddMark(int line, int markerNum, int linesTotal) {
+	handleCurrent++;
+	if ((line < 0) || (line >= linesTotal) || (markerNum < 0) || (markerNum > MARKER_MAX)) {
 		return -1;
 	}
-	if (!markers[line]) {
+	const int index = SetFromLine(line);
+	if ((index >= sets.Length()) || (LineOfSet(index) != line)) {
 		// Need new structure to hold marker handle
-		markers[line] = new MarkerHandleSet();
+		InsertSet(index, line);
 	}
-	markers[line]->InsertHandle(handleCurrent, markerNum);
+	sets[index]->InsertHandle(handleCurrent, markerNum);
+	SetValue(index, values[index] | (1 << markerNum));
+	handles[handleCurrent] = sets[index];
+	numberCounts[markerNum]++;
 
 	return handleCurrent;
 }
 
+/// Add markers from pairs of line and marker number, returning the handle of the first.
+int LineMarkers::AddMarks(int count, const int *linesAndMarkers, int linesTotal) {
+	const int handleFirst = handleCurrent + 1;
+	for (int i = 0; i < count; i++)
+		AddMark(linesAndMarkers[i * 2], linesAndMarkers[i * 2 + 1], linesTotal);
+	return handleFirst;
+}
+
 bool LineMarkers::DeleteMark(int line, int markerNum, bool all) {
 	bool someChanges = false;
-	if (markers.Length() && (line >= 0) && (line < markers.Length()) && markers[line]) {
+	const int index = SetFromLine(line);
+	if ((line >= 0) && (index < sets.Length()) && (LineOfSet(index) == line)) {
+		MarkerHandleSet *set = sets[index];
 		if (markerNum == -1) {
 			someChanges = true;
-			delete markers[line];
-			markers[line] = NULL;
+			RemoveSet(index, true);
 		} else {
-			someChanges = markers[line]->RemoveNumber(markerNum, all);
-			if (markers[line]->Length() == 0) {
-				delete markers[line];
-				markers[line] = NULL;
+			// Forget the same handles RemoveNumber will remove
+			for (const MarkerHandleNumber *mhn = set->First(); mhn; mhn = mhn->next) {
+				if (mhn->number == markerNum) {
+					handles.erase(mhn->handle);
+					numberCounts[markerNum]--;
+					if (!all)
+						break;
+				}
+			}
+			someChanges = set->RemoveNumber(markerNum, all);
+			if (set->Length() == 0) {
+				RemoveSet(index, false);
+			} else {
+				SetValue(index, set->MarkValue());
+			}
+		}
+	}
+	return someChanges;
+}
+
+bool LineMarkers::DeleteAllMarks(int markerNum) {
+	bool someChanges = false;
+	if ((markerNum == -1) || ((markerNum >= 0) && (markerNum <= MARKER_MAX) && numberCounts[markerNum])) {
+		for (int index = sets.Length() - 1; index >= 0; index--) {
+			if ((markerNum == -1) || (values[index] & (1 << markerNum))) {
+				if (DeleteMark(LineOfSet(index), markerNum, true))
+					someChanges = true;
 			}
 		}
 	}
@@ -225,108 +458,285 @@ bool LineMarkers::DeleteMark(int line, int markerNum, bool all) {
 void LineMarkers::DeleteMarkFromHandle(int markerHandle) {
 	int line = LineFromHandle(markerHandle);
 	if (line >= 0) {
-		markers[line]->RemoveHandle(markerHandle);
-		if (markers[line]->Length() == 0) {
-			delete markers[line];
-			markers[line] = NULL;
+		MarkerHandleSet *set = handles[markerHandle];
+		const int index = set->index;
+		for (const MarkerHandleNumber *mhn = set->First(); mhn; mhn = mhn->next) {
+			if (mhn->handle == markerHandle) {
+				numberCounts[mhn->number]--;
+				break;
+			}
+		}
+		handles.erase(markerHandle);
+		set->RemoveHandle(markerHandle);
+		if (set->Length() == 0) {
+			RemoveSet(index, false);
+		} else {
+			SetValue(index, set->MarkValue());
 		}
 	}
 }
 
-LineLevels::~LineLevels() {
+// Key above any level number so unwanted lines are never found
+static const int levelNone = SC_FOLDLEVELNUMBERMASK + 1;
+
+LineColumns::LineColumns() :
+	lengthLevels(0), lengthStates(0), treeLeaves(0), treeValid(false), linesScanned(0) {
+}
+
+LineColumns::~LineColumns() {
+}
+
+void LineColumns::Init() {
+	rows.DeleteAll();
+	lengthLevels = 0;
+	lengthStates = 0;
+	InvalidateTree();
+}
+
+/// Rows past the end of either column hold its default so they can be taken up later.
+void LineColumns::EnsureRows(int length) {
+	if (rows.Length() < length) {
+		Row rowDefault = { SC_FOLDLEVELBASE, 0 };
+		rows.InsertValue(rows.Length(), length - rows.Length(), rowDefault);
+	}
 }
 
-void LineLevels::Init() {
-	levels.DeleteAll();
+void LineColumns::InsertLine(int line) {
+	InsertLines(line, 1);
 }
 
-void LineLevels::InsertLine(int line) {
-	if (levels.Length()) {
-		int level = (line < levels.Length()) ? levels[line] : SC_FOLDLEVELBASE;
-		levels.InsertValue(line, 1, level);
+/**
+ * Insert lines before line, each a copy of line as inserting them one at a time would.
+ */
+void LineColumns::InsertLines(int line, int lines) {
+	if ((lengthLevels || lengthStates) && (lines > 0)) {
+		Row row = { SC_FOLDLEVELBASE, 0 };
+		if (line < rows.Length())
+			row = rows[line];
+		if (lengthLevels) {
+			lengthLevels += lines;
+			InvalidateTree();
+		}
+		if (lengthStates)
+			lengthStates = std::max(lengthStates, line) + lines;
+		EnsureRows(line);
+		rows.InsertValue(line, lines, row);
 	}
 }
 
-void LineLevels::RemoveLine(int line) {
-	if (levels.Length()) {
+void LineColumns::RemoveLine(int line) {
+	if (lengthLevels) {
+		InvalidateTree();
 		// Move up following lines but merge header flag from this line
 		// to line before to avoid a temporary disappearence causing expansion.
-		int firstHeader = levels[line] & SC_FOLDLEVELHEADERFLAG;
-		levels.Delete(line);
-		if (line == levels.Length()-1) // Last line loses the header flag
-			levels[line-1] &= ~SC_FOLDLEVELHEADERFLAG;
+		int firstHeader = rows[line].level & SC_FOLDLEVELHEADERFLAG;
+		lengthLevels--;
+		if (line == lengthLevels-1) // Last line loses the header flag
+			rows[line-1].level &= ~SC_FOLDLEVELHEADERFLAG;
 		else if (line > 0)
-			levels[line-1] |= firstHeader;
+			rows[line-1].level |= firstHeader;
 	}
+	if (lengthStates > line)
+		lengthStates--;
+	if (line < rows.Length())
+		rows.Delete(line);
 }
 
-void LineLevels::ExpandLevels(int sizeNew) {
-	levels.InsertValue(levels.Length(), sizeNew - levels.Length(), SC_FOLDLEVELBASE);
+void LineColumns::ExpandLevels(int sizeNew) {
+	EnsureRows(sizeNew);
+	lengthLevels = std::max(lengthLevels, sizeNew);
+	InvalidateTree();
 }
 
-void LineLevels::ClearLevels() {
-	levels.DeleteAll();
+void LineColumns::ClearLevels() {
+	if (lengthStates) {
+		for (int line = 0; line < lengthLevels; line++)
+			rows[line].level = SC_FOLDLEVELBASE;
+	} else {
+		rows.DeleteAll();
+	}
+	lengthLevels = 0;
+	InvalidateTree();
 }
 
-int LineLevels::SetLevel(int line, int level, int lines) {
+int LineColumns::SetLevel(int line, int level, int lines) {
 	int prev = 0;
 	if ((line >= 0) && (line < lines)) {
-		if (!levels.Length()) {
+		if (!lengthLevels) {
 			ExpandLevels(lines + 1);
 		}
-		prev = levels[line];
+		prev = rows[line].level;
 		if (prev != level) {
-			levels[line] = level;
+			rows[line].level = level;
+			if (treeValid)
+				UpdateTree(line);
 		}
 	}
 	return prev;
 }
 
-int LineLevels::GetLevel(int line) const {
-	if (levels.Length() && (line >= 0) && (line < levels.Length())) {
-		return levels[line];
+int LineColumns::GetLevel(int line) const {
+	if ((line >= 0) && (line < lengthLevels)) {
+		return rows[line].level;
 	} else {
 		return SC_FOLDLEVELBASE;
 	}
 }
 
-LineState::~LineState() {
+/// The level number of a line in the headers tree or the whitespace ignoring tree.
+int LineColumns::Key(int level, bool header) {
+	if (header)
+		return (level & SC_FOLDLEVELHEADERFLAG) ? (level & SC_FOLDLEVELNUMBERMASK) : levelNone;
+	else
+		return (level & SC_FOLDLEVELWHITEFLAG) ? levelNone : (level & SC_FOLDLEVELNUMBERMASK);
+}
+
+void LineColumns::BuildTree() const {
+	// Leaves start at treeLeaves and each node holds the minimum of its two children
+	treeLeaves = 1;
+	while (treeLeaves < lengthLevels)
+		treeLeaves *= 2;
+	treeLevels.assign(treeLeaves * 2, static_cast<unsigned short>(levelNone));
+	treeHeaders.assign(treeLeaves * 2, static_cast<unsigned short>(levelNone));
+	for (int line = 0; line < lengthLevels; line++) {
+		treeLevels[treeLeaves + line] = static_cast<unsigned short>(Key(rows[line].level, false));
+		treeHeaders[treeLeaves + line] = static_cast<unsigned short>(Key(rows[line].level, true));
+	}
+	for (int node = treeLeaves - 1; node > 0; node--) {
+		treeLevels[node] = std::min(treeLevels[node * 2], treeLevels[node * 2 + 1]);
+		treeHeaders[node] = std::min(treeHeaders[node * 2], treeHeaders[node * 2 + 1]);
+	}
+	treeValid = true;
 }
 
-void LineState::Init() {
-	lineStates.DeleteAll();
+void LineColumns::UpdateTree(int line) const {
+	int node = treeLeaves + line;
+	treeLevels[node] = static_cast<unsigned short>(Key(rows[line].level, false));
+	treeHeaders[node] = static_cast<unsigned short>(Key(rows[line].level, true));
+	for (node /= 2; node > 0; node /= 2) {
+		treeLevels[node] = std::min(treeLevels[node * 2], treeLevels[node * 2 + 1]);
+		treeHeaders[node] = std::min(treeHeaders[node * 2], treeHeaders[node * 2 + 1]);
+	}
 }
 
-void LineState::InsertLine(int line) {
-	if (lineStates.Length()) {
-		lineStates.EnsureLength(line);
-		int val = (line < lineStates.Length()) ? lineStates[line] : 0;
-		lineStates.Insert(line, val);
-	}
+void LineColumns::InvalidateTree() {
+	treeValid = false;
+	linesScanned = 0;
 }
 
-void LineState::RemoveLine(int line) {
-	if (lineStates.Length() > line) {
-		lineStates.Delete(line);
+/**
+ * Find the first line from line up to but not including lineEnd with a level number at or
+ * below levelNumber which is not whitespace or, when header is true, which is a fold header.
+ * Returns -1 when there is no such line.
+ */
+int LineColumns::FirstAtOrBelow(int line, int lineEnd, int levelNumber, bool header) const {
+	line = std::max(line, 0);
+	if (!lengthLevels) {
+		// Every line is at the base level
+		return (!header && (levelNumber >= SC_FOLDLEVELBASE) && (line < lineEnd)) ? line : -1;
+	}
+	lineEnd = std::min(lineEnd, lengthLevels);
+	const int lineEndScan = std::min(lineEnd, line + lengthScan);
+	for (; line < lineEndScan; line++) {
+		if (Key(rows[line].level, header) <= levelNumber)
+			return line;
+	}
+	if (!treeValid) {
+		// Rebuild only once scanning has cost as much as rebuilding
+		for (; (line < lineEnd) && (linesScanned < lengthLevels); line++, linesScanned++) {
+			if (Key(rows[line].level, header) <= levelNumber)
+				return line;
+		}
+		if (line < lineEnd)
+			BuildTree();
+	}
+	if (line >= lineEnd)
+		return -1;
+	const std::vector<unsigned short> &tree = header ? treeHeaders : treeLevels;
+	int node = treeLeaves + line;
+	while (tree[node] > levelNumber) {
+		// Climb while a right child then move to the following subtree
+		while (node & 1)
+			node /= 2;
+		if (node == 0)
+			return -1;
+		node++;
+	}
+	while (node < treeLeaves) {
+		node *= 2;
+		if (tree[node] > levelNumber)
+			node++;
+	}
+	line = node - treeLeaves;
+	return (line < lineEnd) ? line : -1;
+}
+
+/**
+ * Find the last line from line back to the start with a level number at or below levelNumber
+ * which is not whitespace or, when header is true, which is a fold header.
+ * Returns -1 when there is no such line.
+ */
+int LineColumns::LastAtOrBelow(int line, int levelNumber, bool header) const {
+	if (!lengthLevels) {
+		return (!header && (levelNumber >= SC_FOLDLEVELBASE) && (line >= 0)) ? line : -1;
 	}
+	line = std::min(line, lengthLevels - 1);
+	const int lineStartScan = std::max(line - lengthScan, -1);
+	for (; line > lineStartScan; line--) {
+		if (Key(rows[line].level, header) <= levelNumber)
+			return line;
+	}
+	if (!treeValid) {
+		for (; (line >= 0) && (linesScanned < lengthLevels); line--, linesScanned++) {
+			if (Key(rows[line].level, header) <= levelNumber)
+				return line;
+		}
+		if (line >= 0)
+			BuildTree();
+	}
+	if (line < 0)
+		return -1;
+	const std::vector<unsigned short> &tree = header ? treeHeaders : treeLevels;
+	int node = treeLeaves + line;
+	while (tree[node] > levelNumber) {
+		// Climb while a left child then move to the preceding subtree
+		while ((node > 1) && !(node & 1))
+			node /= 2;
+		if (node == 1)
+			return -1;
+		node--;
+	}
+	while (node < treeLeaves) {
+		node = node * 2 + 1;
+		if (tree[node] > levelNumber)
+			node--;
+	}
+	return node - treeLeaves;
 }
 
-int LineState::SetLineState(int line, int state) {
-	lineStates.EnsureLength(line + 1);
-	int stateOld = lineStates[line];
-	lineStates[line] = state;
+int LineColumns::SetLineState(int line, int state) {
+	if (line >= lengthStates) {
+		EnsureRows(line + 1);
+		lengthStates = line + 1;
+	}
+	int stateOld = rows[line].state;
+	rows[line].state = state;
 	return stateOld;
 }
 
-int LineState::GetLineState(int line) {
+int LineColumns::GetLineState(int line) {
 	if (line < 0)
 		return 0;
-	lineStates.EnsureLength(line + 1);
-	return lineStates[line];
+	// Lexers on other threads read states already allocated so only write when growing
+	if (line >= lengthStates) {
+		EnsureRows(line + 1);
+		lengthStates = line + 1;
+	}
+	return rows[line].state;
 }
 
-int LineState::GetMaxLineState() const {
-	return lineStates.Length();
+int LineColumns::GetMaxLineState() const {
+	return lengthStates;
 }
 
 static int NumberLines(const char *text) {
@@ -343,8 +753,8 @@ static int NumberLines(const char *text) {
 	}
 }
 
-// Each allocated LineAnnotation is a char array which starts with an AnnotationHeader
-// and then has text and optional styles.
+// Each LineAnnotation is stored in the arena as an AnnotationHeader followed by
+// text and optional styles.
 
 static const int IndividualStyles = 0x100;
 
@@ -354,8 +764,18 @@ struct AnnotationHeader {
 	int length;
 };
 
+// Entries are whole multiples of the header size so each header is aligned.
+static int EntrySize(int length, int style) {
+	const int headerSize = static_cast<int>(sizeof(AnnotationHeader));
+	const int size = headerSize + length + ((style == IndividualStyles) ? length : 0);
+	return (size + headerSize - 1) / headerSize * headerSize;
+}
+
+// Offset 0 holds no annotation so can mark lines without one.
+LineAnnotation::LineAnnotation() : arena(sizeof(AnnotationHeader)), lengthFree(0) {
+}
+
 LineAnnotation::~LineAnnotation() {
-	ClearAll();
 }
 
 void LineAnnotation::Init() {
@@ -369,118 +789,152 @@ void LineAnnotation::InsertLine(int line) {
 	}
 }
 
+void LineAnnotation::InsertLines(int line, int lines) {
+	if (annotations.Length()) {
+		annotations.EnsureLength(line);
+		annotations.InsertValue(line, lines, 0);
+	}
+}
+
 void LineAnnotation::RemoveLine(int line) {
 	if (annotations.Length() && (line < annotations.Length())) {
-		delete []annotations[line];
+		Release(line);
 		annotations.Delete(line);
 	}
 }
 
-bool LineAnnotation::MultipleStyles(int line) const {
+const AnnotationHeader *LineAnnotation::Header(int line) const {
 	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return reinterpret_cast<AnnotationHeader *>(annotations[line])->style == IndividualStyles;
+		return reinterpret_cast<const AnnotationHeader *>(&arena[annotations[line]]);
 	else
 		return 0;
 }
 
+AnnotationHeader *LineAnnotation::Header(int line) {
+	return const_cast<AnnotationHeader *>(static_cast<const LineAnnotation *>(this)->Header(line));
+}
+
+/**
+ * Add a zeroed entry to the end of the arena and return its offset.
+ * The arena is first compacted if most of it is taken by released entries and there is
+ * enough of that to repay walking every line, so offsets must be read again afterwards.
+ */
+int LineAnnotation::Allocate(int length, int style) {
+	if ((lengthFree > static_cast<int>(arena.size()) / 2) &&
+		(lengthFree > annotations.Length() * static_cast<int>(sizeof(int)))) {
+		std::vector<char> arenaCompact(sizeof(AnnotationHeader));
+		arenaCompact.reserve(arena.size() - lengthFree);
+		for (int line = 0; line < annotations.Length(); line++) {
+			if (annotations[line]) {
+				const AnnotationHeader *pah = Header(line);
+				const char *entry = &arena[annotations[line]];
+				annotations[line] = static_cast<int>(arenaCompact.size());
+				arenaCompact.insert(arenaCompact.end(), entry, entry + EntrySize(pah->length, pah->style));
+			}
+		}
+		arena.swap(arenaCompact);
+		lengthFree = 0;
+	}
+	const int offset = static_cast<int>(arena.size());
+	arena.resize(offset + EntrySize(length, style), 0);
+	AnnotationHeader *pah = reinterpret_cast<AnnotationHeader *>(&arena[offset]);
+	pah->style = static_cast<short>(style);
+	pah->length = length;
+	return offset;
+}
+
+/// The space of a released entry is reclaimed when the arena is next compacted.
+void LineAnnotation::Release(int line) {
+	const AnnotationHeader *pah = Header(line);
+	if (pah) {
+		lengthFree += EntrySize(pah->length, pah->style);
+		annotations[line] = 0;
+	}
+}
+
+bool LineAnnotation::MultipleStyles(int line) const {
+	const AnnotationHeader *pah = Header(line);
+	return pah && (pah->style == IndividualStyles);
+}
+
 int LineAnnotation::Style(int line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return reinterpret_cast<AnnotationHeader *>(annotations[line])->style;
-	else
-		return 0;
+	const AnnotationHeader *pah = Header(line);
+	return pah ? pah->style : 0;
 }
 
 const char *LineAnnotation::Text(int line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return annotations[line]+sizeof(AnnotationHeader);
-	else
-		return 0;
+	const AnnotationHeader *pah = Header(line);
+	return pah ? reinterpret_cast<const char *>(pah + 1) : 0;
 }
 
 const unsigned char *LineAnnotation::Styles(int line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line] && MultipleStyles(line))
-		return reinterpret_cast<unsigned char *>(annotations[line] + sizeof(AnnotationHeader) + Length(line));
+	const AnnotationHeader *pah = Header(line);
+	if (pah && (pah->style == IndividualStyles))
+		return reinterpret_cast<const unsigned char *>(pah + 1) + pah->length;
 	else
 		return 0;
 }
 
-static char *AllocateAnnotation(int length, int style) {
-	size_t len = sizeof(AnnotationHeader) + length + ((style == IndividualStyles) ? length : 0);
-	char *ret = new char[len];
-	memset(ret, 0, len);
-	return ret;
-}
-
 void LineAnnotation::SetText(int line, const char *text) {
 	if (text && (line >= 0)) {
 		annotations.EnsureLength(line+1);
-		int style = Style(line);
-		if (annotations[line]) {
-			delete []annotations[line];
-		}
-		annotations[line] = AllocateAnnotation(static_cast<int>(strlen(text)), style);
-		AnnotationHeader *pah = reinterpret_cast<AnnotationHeader *>(annotations[line]);
-		pah->style = static_cast<short>(style);
-		pah->length = static_cast<int>(strlen(text));
+		const int style = Style(line);
+		const int length = static_cast<int>(strlen(text));
+		Release(line);
+		annotations[line] = Allocate(length, style);
+		AnnotationHeader *pah = Header(line);
 		pah->lines = static_cast<short>(NumberLines(text));
-		memcpy(annotations[line]+sizeof(AnnotationHeader), text, pah->length);
+		memcpy(pah + 1, text, length);
 	} else {
-		if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line]) {
-			delete []annotations[line];
-			annotations[line] = 0;
+		if (annotations.Length() && (line >= 0) && (line < annotations.Length())) {
+			Release(line);
 		}
 	}
 }
 
 void LineAnnotation::ClearAll() {
-	for (int line = 0; line < annotations.Length(); line++) {
-		delete []annotations[line];
-		annotations[line] = 0;
-	}
 	annotations.DeleteAll();
+	std::vector<char>(sizeof(AnnotationHeader)).swap(arena);
+	lengthFree = 0;
 }
 
 void LineAnnotation::SetStyle(int line, int style) {
 	annotations.EnsureLength(line+1);
 	if (!annotations[line]) {
-		annotations[line] = AllocateAnnotation(0, style);
+		annotations[line] = Allocate(0, style);
 	}
-	reinterpret_cast<AnnotationHeader *>(annotations[line])->style = static_cast<short>(style);
+	// Switching to individual styles needs the space allocated by SetStyles
+	if ((style != IndividualStyles) || MultipleStyles(line))
+		Header(line)->style = static_cast<short>(style);
 }
 
 void LineAnnotation::SetStyles(int line, const unsigned char *styles) {
 	if (line >= 0) {
 		annotations.EnsureLength(line+1);
 		if (!annotations[line]) {
-			annotations[line] = AllocateAnnotation(0, IndividualStyles);
-		} else {
-			AnnotationHeader *pahSource = reinterpret_cast<AnnotationHeader *>(annotations[line]);
-			if (pahSource->style != IndividualStyles) {
-				char *allocation = AllocateAnnotation(pahSource->length, IndividualStyles);
-				AnnotationHeader *pahAlloc = reinterpret_cast<AnnotationHeader *>(allocation);
-				pahAlloc->length = pahSource->length;
-				pahAlloc->lines = pahSource->lines;
-				memcpy(allocation + sizeof(AnnotationHeader), annotations[line] + sizeof(AnnotationHeader), pahSource->length);
-				delete []annotations[line];
-				annotations[line] = allocation;
-			}
+			annotations[line] = Allocate(0, IndividualStyles);
+		} else if (!MultipleStyles(line)) {
+			const int offset = Allocate(Length(line), IndividualStyles);
+			// Allocating may have compacted so find the source after
+			const AnnotationHeader *pahSource = Header(line);
+			AnnotationHeader *pahAlloc = reinterpret_cast<AnnotationHeader *>(&arena[offset]);
+			pahAlloc->lines = pahSource->lines;
+			memcpy(pahAlloc + 1, pahSource + 1, pahSource->length);
+			Release(line);
+			annotations[line] = offset;
 		}
-		AnnotationHeader *pah = reinterpret_cast<AnnotationHeader *>(annotations[line]);
+		AnnotationHeader *pah = Header(line);
 		pah->style = IndividualStyles;
-		memcpy(annotations[line] + sizeof(AnnotationHeader) + pah->length, styles, pah->length);
+		memcpy(reinterpret_cast<char *>(pah + 1) + pah->length, styles, pah->length);
 	}
 }
 
 int LineAnnotation::Length(int line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return reinterpret_cast<AnnotationHeader *>(annotations[line])->length;
-	else
-		return 0;
+	const AnnotationHeader *pah = Header(line);
+	return pah ? pah->length : 0;
 }
 
 int LineAnnotation::Lines(int line) const {
-	if (annotations.Length() && (line >= 0) && (line < annotations.Length()) && annotations[line])
-		return reinterpret_cast<AnnotationHeader *>(annotations[line])->lines;
-	else
-		return 0;
+	const AnnotationHeader *pah = Header(line);
+	return pah ? pah->lines : 0;
 }
@@ -38,66 +38,148 @@ public:
 	void RemoveHandle(int handle);
 	bool RemoveNumber(int markerNum, bool all);
 	void CombineWith(MarkerHandleSet *other);
+	const MarkerHandleNumber *First() const {
+		return root;
+	}
+	/// Position in the owner's list of sets which may be out of date
+	int index;
 };
 
+/**
+ * Markers are only stored for lines that have them, in line order.
+ * Handles are indexed so finding the line of a handle does not search the lines.
+ * A tree holding the union of the mark values over ranges of sets lets searches for
+ * particular markers skip runs of sets without them. It is updated in place as values
+ * change and as sets are added or removed at the end. Inserting or removing other sets
+ * invalidates it, then searches go set by set until they have examined as many sets as
+ * rebuilding it would take.
+ */
 class LineMarkers : public PerLine {
-	SplitVector<MarkerHandleSet *> markers;
+	/// The set at index i is on the line before the start of partition i+1 so inserting
+	/// and removing lines moves the following sets by adjusting the partitions.
+	Partitioning lines;
+	SplitVector<MarkerHandleSet *> sets;
+	/// Bit set of marker numbers for each set to search without following lists
+	SplitVector<int> values;
+	typedef std::map<int, MarkerHandleSet *> HandleMap;
+	HandleMap handles;
+	/// The index member of sets before this position is correct
+	int indexValid;
+	/// Number of markers of each marker number to quickly find that there are none
+	int numberCounts[MARKER_MAX+1];
 	/// Handles are allocated sequentially and should never have to be reused as 32 bit ints are very big.
 	int handleCurrent;
+	mutable std::vector<int> treeValues;
+	mutable int treeLeaves;
+	mutable bool treeValid;
+	mutable int setsScanned;
+
+	int LineOfSet(int index) const;
+	int SetFromLine(int line) const;
+	void InsertSet(int index, int line);
+	void RemoveSet(int index, bool forget);
+	void Forget(const MarkerHandleNumber *mhn);
+	bool AnyOf(int mask) const;
+	void SetValue(int index, int value);
+	void BuildTree() const;
+	void InvalidateTree();
+	int FirstSetWith(int index, int mask) const;
+	int LastSetWith(int index, int mask) const;
 public:
-	LineMarkers() : handleCurrent(0) {
-	}
+	/// Number of sets examined one by one before consulting the tree
+	enum { lengthScan = 64 };
+	LineMarkers();
 	virtual ~LineMarkers();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lineCount);
 	virtual void RemoveLine(int line);
 
 	int MarkValue(int line);
 	int MarkerNext(int lineStart, int mask) const;
-	int AddMark(int line, int marker, int lines);
+	int MarkerPrevious(int lineStart, int mask) const;
+	int AddMark(int line, int marker, int linesTotal);
+	int AddMarks(int count, const int *linesAndMarkers, int linesTotal);
 	void MergeMarkers(int pos);
 	bool DeleteMark(int line, int markerNum, bool all);
+	bool DeleteAllMarks(int markerNum);
 	void DeleteMarkFromHandle(int markerHandle);
 	int LineFromHandle(int markerHandle);
 };
 
-class LineLevels : public PerLine {
-	SplitVector<int> levels;
+/**
+ * Fold level and lexer state of each line, held together so that both move with a
+ * single gap and lines are inserted and removed once for both.
+ * Each column behaves as if held in its own lazily allocated vector: levels cover every
+ * line once any is set and states cover lines up to the highest one accessed.
+ * Searches for the next or previous fold boundary look at nearby lines directly and then use
+ * trees holding the minimum level number over ranges of lines, one ignoring whitespace lines
+ * and one of just fold headers. The trees are updated in place as levels are set.
+ * Inserting or removing lines invalidates the trees and searches then carry on line by line
+ * until they have examined as many lines as rebuilding the trees would take, so editing
+ * followed by nearby searches costs no more than the distance searched.
+ */
+class LineColumns : public PerLine {
+	struct Row {
+		int level;
+		int state;
+	};
+	SplitVector<Row> rows;
+	int lengthLevels;
+	int lengthStates;
+	mutable std::vector<unsigned short> treeLevels;
+	mutable std::vector<unsigned short> treeHeaders;
+	mutable int treeLeaves;
+	mutable bool treeValid;
+	mutable int linesScanned;
+	static int Key(int level, bool header);
+	void BuildTree() const;
+	void UpdateTree(int line) const;
+	void InvalidateTree();
+	void EnsureRows(int length);
 public:
-	virtual ~LineLevels();
+	/// Number of lines examined one by one before consulting the trees
+	enum { lengthScan = 64 };
+	LineColumns();
+	virtual ~LineColumns();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	void ExpandLevels(int sizeNew=-1);
 	void ClearLevels();
 	int SetLevel(int line, int level, int lines);
 	int GetLevel(int line) const;
-};
-
-class LineState : public PerLine {
-	SplitVector<int> lineStates;
-public:
-	LineState() {
-	}
-	virtual ~LineState();
-	virtual void Init();
-	virtual void InsertLine(int line);
-	virtual void RemoveLine(int line);
+	int FirstAtOrBelow(int line, int lineEnd, int levelNumber, bool header) const;
+	int LastAtOrBelow(int line, int levelNumber, bool header) const;
 
 	int SetLineState(int line, int state);
 	int GetLineState(int line);
 	int GetMaxLineState() const;
 };
 
+struct AnnotationHeader;
+
+/**
+ * Annotations are held one after another in a single arena with each line holding the
+ * offset of its annotation, so setting many annotations does not allocate each one.
+ * Replaced annotations stay in the arena until enough accumulate to compact it.
+ */
 class LineAnnotation : public PerLine {
-	SplitVector<char *> annotations;
+	SplitVector<int> annotations;
+	std::vector<char> arena;
+	int lengthFree;
+	const AnnotationHeader *Header(int line) const;
+	AnnotationHeader *Header(int line);
+	int Allocate(int length, int style);
+	void Release(int line);
 public:
-	LineAnnotation() {
-	}
+	LineAnnotation();
 	virtual ~LineAnnotation();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	bool MultipleStyles(int line) const;
@@ -53,6 +53,11 @@ LineLayout::LineLayout(int maxLineLength_) :
 	lenLineStarts(0),
 	lineNumber(-1),
 	inCache(false),
+	lruPrev(0),
+	lruNext(0),
+	bytesAccounted(0),
+	positionsCompact(0),
+	lenPositionsCompact(0),
 	maxLineLength(-1),
 	numCharsInLine(0),
 	numCharsBeforeEOL(0),
@@ -71,7 +76,10 @@ LineLayout::LineLayout(int maxLineLength_) :
 	hsEnd(0),
 	widthLine(wrapWidthInfinite),
 	lines(1),
-	wrapIndent(0) {
+	wrapIndent(0),
+	windowed(false),
+	xWindowStart(0),
+	xWindowEnd(0) {
 	bracePreviousStyles[0] = 0;
 	bracePreviousStyles[1] = 0;
 	Resize(maxLineLength_);
@@ -103,6 +111,10 @@ void LineLayout::Free() {
 	indicators = 0;
 	delete []positions;
 	positions = 0;
+	delete []positionsCompact;
+	positionsCompact = 0;
+	lenPositionsCompact = 0;
+	positionsWide.clear();
 	delete []lineStarts;
 	lineStarts = 0;
 }
@@ -209,9 +221,144 @@ int LineLayout::EndLineStyle() const {
 	return styles[numCharsBeforeEOL > 0 ? numCharsBeforeEOL-1 : 0];
 }
 
+/**
+ * Replace the positions array with deltas between successive positions.
+ * Only performed when decoding reproduces every position exactly so that
+ * a compacted layout can be used again without being measured.
+ */
+bool LineLayout::Compact() {
+	if (positionsCompact || !positions || (validity < llPositions))
+		return false;
+	const int lenPositions = numCharsInLine + 1;
+	unsigned short *deltas = new unsigned short[lenPositions];
+	std::vector<XYPOSITION> wide;
+	XYPOSITION xDecoded = 0;
+	for (int i = 0; i < lenPositions; i++) {
+		const XYPOSITION delta = positions[i] - xDecoded;
+		if (delta < 0) {
+			delete []deltas;
+			return false;
+		}
+		const double units = static_cast<double>(delta) * compactScale;
+		if ((units < compactEscape) && (static_cast<unsigned short>(units) == units)) {
+			deltas[i] = static_cast<unsigned short>(units);
+			xDecoded += static_cast<XYPOSITION>(static_cast<double>(deltas[i]) / compactScale);
+		} else {
+			deltas[i] = compactEscape;
+			wide.push_back(delta);
+			xDecoded += delta;
+		}
+		if (xDecoded != positions[i]) {
+			delete []deltas;
+			return false;
+		}
+	}
+	delete []positions;
+	positions = 0;
+	positionsCompact = deltas;
+	lenPositionsCompact = lenPositions;
+	positionsWide.swap(wide);
+	return true;
+}
+
+void LineLayout::Expand() {
+	if (!positionsCompact)
+		return;
+	positions = new XYPOSITION[maxLineLength + 1 + 1];
+	size_t wideUsed = 0;
+	XYPOSITION xDecoded = 0;
+	for (int i = 0; i < lenPositionsCompact; i++) {
+		if (positionsCompact[i] == compactEscape) {
+			xDecoded += positionsWide[wideUsed++];
+		} else {
+			xDecoded += static_cast<XYPOSITION>(static_cast<double>(positionsCompact[i]) / compactScale);
+		}
+		positions[i] = xDecoded;
+	}
+	delete []positionsCompact;
+	positionsCompact = 0;
+	lenPositionsCompact = 0;
+	std::vector<XYPOSITION>().swap(positionsWide);
+}
+
+size_t LineLayout::MemoryUsage() const {
+	size_t bytes = sizeof(LineLayout);
+	if (chars)
+		bytes += (maxLineLength + 1) * (sizeof(*chars) + sizeof(*styles) + sizeof(*indicators));
+	if (positions)
+		bytes += (maxLineLength + 1 + 1) * sizeof(XYPOSITION);
+	bytes += lenPositionsCompact * sizeof(unsigned short);
+	bytes += positionsWide.capacity() * sizeof(XYPOSITION);
+	bytes += lenLineStarts * sizeof(int);
+	return bytes;
+}
+
+void LongLineIndex::Clear() {
+	starts.clear();
+	widths.clear();
+	tree.clear();
+	measured.clear();
+}
+
+void LongLineIndex::Allocate(const std::vector<int> &starts_, const std::vector<XYACCUMULATOR> &widths_) {
+	PLATFORM_ASSERT(starts_.size() == widths_.size() + 1);
+	starts = starts_;
+	widths = widths_;
+	measured.assign(widths.size(), false);
+	// Build the Fenwick tree in linear time
+	const size_t n = widths.size();
+	tree.assign(n + 1, 0);
+	for (size_t i = 1; i <= n; i++) {
+		tree[i] += widths[i - 1];
+		const size_t parent = i + (i & (~i + 1));
+		if (parent <= n)
+			tree[parent] += tree[i];
+	}
+}
+
+int LongLineIndex::ChunkFromPosition(int position) const {
+	const std::vector<int>::const_iterator it = std::upper_bound(starts.begin(), starts.end() - 1, position);
+	return std::max(static_cast<int>(it - starts.begin()) - 1, 0);
+}
+
+// The x position of the start of chunk which is the sum of the widths of the previous chunks.
+XYACCUMULATOR LongLineIndex::XFromChunk(int chunk) const {
+	XYACCUMULATOR x = 0;
+	for (size_t i = chunk; i > 0; i -= (i & (~i + 1))) {
+		x += tree[i];
+	}
+	return x;
+}
+
+// The chunk containing x which is the last chunk starting at or before x.
+int LongLineIndex::ChunkFromX(XYACCUMULATOR x) const {
+	const size_t n = widths.size();
+	size_t step = 1;
+	while (step * 2 <= n)
+		step *= 2;
+	size_t chunk = 0;
+	for (; step > 0; step /= 2) {
+		if ((chunk + step <= n) && (tree[chunk + step] <= x)) {
+			chunk += step;
+			x -= tree[chunk];
+		}
+	}
+	return std::min(static_cast<int>(chunk), static_cast<int>(n) - 1);
+}
+
+void LongLineIndex::SetMeasured(int chunk, XYACCUMULATOR width) {
+	const XYACCUMULATOR delta = width - widths[chunk];
+	widths[chunk] = width;
+	measured[chunk] = true;
+	for (size_t i = chunk + 1; i < tree.size(); i += (i & (~i + 1))) {
+		tree[i] += delta;
+	}
+}
+
 LineLayoutCache::LineLayoutCache() :
 	level(0),
-	allInvalidated(false), styleClock(-1), useCount(0) {
+	allInvalidated(false), styleClock(-1), useCount(0),
+	memoryLimit(0), memoryUsed(0), lruFirst(0), lruLast(0) {
 	Allocate(0);
 }
 
@@ -241,8 +388,7 @@ void LineLayoutCache::AllocateForLevel(int linesOnScreen, int linesInDoc) {
 	} else {
 		if (lengthForLevel < cache.size()) {
 			for (size_t i = lengthForLevel; i < cache.size(); i++) {
-				delete cache[i];
-				cache[i] = 0;
+				Remove(i);
 			}
 		}
 		cache.resize(lengthForLevel);
@@ -255,6 +401,66 @@ void LineLayoutCache::Deallocate() {
 	for (size_t i = 0; i < cache.size(); i++)
 		delete cache[i];
 	cache.clear();
+	lruFirst = 0;
+	lruLast = 0;
+	memoryUsed = 0;
+}
+
+// Make ll the most recently used layout.
+void LineLayoutCache::Link(LineLayout *ll) {
+	ll->lruPrev = 0;
+	ll->lruNext = lruFirst;
+	if (lruFirst)
+		lruFirst->lruPrev = ll;
+	lruFirst = ll;
+	if (!lruLast)
+		lruLast = ll;
+}
+
+void LineLayoutCache::Unlink(LineLayout *ll) {
+	if (ll->lruPrev)
+		ll->lruPrev->lruNext = ll->lruNext;
+	else
+		lruFirst = ll->lruNext;
+	if (ll->lruNext)
+		ll->lruNext->lruPrev = ll->lruPrev;
+	else
+		lruLast = ll->lruPrev;
+	ll->lruPrev = 0;
+	ll->lruNext = 0;
+}
+
+// Update memoryUsed after ll may have been resized, compacted or expanded.
+void LineLayoutCache::Account(LineLayout *ll) {
+	memoryUsed -= ll->bytesAccounted;
+	ll->bytesAccounted = ll->MemoryUsage();
+	memoryUsed += ll->bytesAccounted;
+}
+
+void LineLayoutCache::Remove(size_t pos) {
+	if (cache[pos]) {
+		Unlink(cache[pos]);
+		memoryUsed -= cache[pos]->bytesAccounted;
+		delete cache[pos];
+		cache[pos] = 0;
+	}
+}
+
+/**
+ * When the document level cache exceeds its memory limit, first compact the positions
+ * of the least recently used layouts and then, if that is not sufficient, discard
+ * least recently used layouts.
+ */
+void LineLayoutCache::EnforceMemoryLimit() {
+	if ((level != llcDocument) || (memoryLimit == 0) || (useCount != 0))
+		return;
+	for (LineLayout *ll = lruLast; ll && (memoryUsed > memoryLimit); ll = ll->lruPrev) {
+		if (ll->Compact())
+			Account(ll);
+	}
+	while (lruLast && (memoryUsed > memoryLimit)) {
+		Remove(lruLast->lineNumber);
+	}
 }
 
 void LineLayoutCache::Invalidate(LineLayout::validLevel validity_) {
@@ -278,6 +484,11 @@ void LineLayoutCache::SetLevel(int level_) {
 	}
 }
 
+void LineLayoutCache::SetMemoryLimit(size_t memoryLimit_) {
+	memoryLimit = memoryLimit_;
+	EnforceMemoryLimit();
+}
+
 LineLayout *LineLayoutCache::Retrieve(int lineNumber, int lineCaret, int maxChars, int styleClock_,
                                       int linesOnScreen, int linesInDoc) {
 	AllocateForLevel(linesOnScreen, linesInDoc);
@@ -305,15 +516,19 @@ LineLayout *LineLayoutCache::Retrieve(int lineNumber, int lineCaret, int maxChar
 			if (cache[pos]) {
 				if ((cache[pos]->lineNumber != lineNumber) ||
 				        (cache[pos]->maxLineLength < maxChars)) {
-					delete cache[pos];
-					cache[pos] = 0;
+					Remove(pos);
 				}
 			}
 			if (!cache[pos]) {
 				cache[pos] = new LineLayout(maxChars);
+			} else {
+				Unlink(cache[pos]);
+				cache[pos]->Expand();
 			}
+			Link(cache[pos]);
 			cache[pos]->lineNumber = lineNumber;
 			cache[pos]->inCache = true;
+			Account(cache[pos]);
 			ret = cache[pos];
 			useCount++;
 		}
@@ -334,10 +549,86 @@ void LineLayoutCache::Dispose(LineLayout *ll) {
 			delete ll;
 		} else {
 			useCount--;
+			// Wrapping may have grown the layout while it was in use
+			Account(ll);
+			EnforceMemoryLimit();
 		}
 	}
 }
 
+LineTileCache::LineTileCache() : active(false) {
+}
+
+LineTileCache::~LineTileCache() {
+	Clear();
+}
+
+void LineTileCache::Erase(MapTile::iterator first, MapTile::iterator last) {
+	for (MapTile::iterator it = first; it != last; ++it) {
+		delete it->second.surface;
+	}
+	tiles.erase(first, last);
+}
+
+void LineTileCache::SetActive(bool active_) {
+	active = active_;
+	if (!active)
+		Clear();
+}
+
+void LineTileCache::Clear() {
+	Erase(tiles.begin(), tiles.end());
+}
+
+void LineTileCache::InvalidateLines(int lineFirst, int lineLast) {
+	if (!tiles.empty()) {
+		Erase(tiles.lower_bound(std::make_pair(lineFirst, 0)),
+			tiles.lower_bound(std::make_pair(lineLast + 1, 0)));
+	}
+}
+
+// Discard tiles outside the range of lines that are likely to be painted soon.
+void LineTileCache::Trim(int lineFirst, int lineLast) {
+	if (!tiles.empty()) {
+		Erase(tiles.begin(), tiles.lower_bound(std::make_pair(lineFirst, 0)));
+		Erase(tiles.lower_bound(std::make_pair(lineLast + 1, 0)), tiles.end());
+	}
+}
+
+const LineTile *LineTileCache::Find(int lineDoc, int subLine, int xOffset, int width, int height) const {
+	MapTile::const_iterator it = tiles.find(std::make_pair(lineDoc, subLine));
+	if ((it != tiles.end()) && (it->second.xOffset == xOffset) &&
+		(it->second.width == width) && (it->second.height == height)) {
+		return &it->second;
+	}
+	return 0;
+}
+
+/**
+ * Return a surface of the given size for the tile of a line.
+ * The caller copies the rendered line into the surface.
+ */
+Surface *LineTileCache::Store(int lineDoc, int subLine, int xOffset, int width, int height, XYPOSITION widthLine,
+	Surface *surfaceWindow, WindowID wid, int technology) {
+	LineTile &tile = tiles[std::make_pair(lineDoc, subLine)];
+	if (!tile.surface || (tile.width != width) || (tile.height != height)) {
+		delete tile.surface;
+		tile.surface = Surface::Allocate(technology);
+		if (tile.surface) {
+			tile.surface->InitPixMap(width, height, surfaceWindow, wid);
+		}
+	}
+	tile.xOffset = xOffset;
+	tile.width = width;
+	tile.height = height;
+	tile.widthLine = widthLine;
+	if (!tile.surface) {
+		tiles.erase(std::make_pair(lineDoc, subLine));
+		return 0;
+	}
+	return tile.surface;
+}
+
 // Simply pack the (maximum 4) character bytes into an int
 static inline int KeyFromString(const char *charBytes, size_t len) {
 	PLATFORM_ASSERT(len <= 4);
@@ -515,7 +806,7 @@ PositionCacheEntry::PositionCacheEntry() :
 }
 
 void PositionCacheEntry::Set(unsigned int styleNumber_, const char *s_,
-	unsigned int len_, XYPOSITION *positions_, unsigned int clock_) {
+	unsigned int len_, const XYPOSITION *positions_, unsigned int clock_) {
 	Clear();
 	styleNumber = styleNumber_;
 	len = len_;
@@ -602,11 +893,14 @@ void PositionCache::SetSize(size_t size_) {
 	pces.resize(size_);
 }
 
-void PositionCache::MeasureWidths(Surface *surface, ViewStyle &vstyle, unsigned int styleNumber,
-	const char *s, unsigned int len, XYPOSITION *positions, Document *pdoc) {
-
-	allClear = false;
-	int probe = -1;
+/**
+ * Look for the positions of a string in the cache.
+ * When not found, @a probe is set to the entry that should be replaced by
+ * the measured positions or to -1 if the string should not be cached.
+ */
+bool PositionCache::Retrieve(unsigned int styleNumber, const char *s, unsigned int len,
+	XYPOSITION *positions, int &probe) const {
+	probe = -1;
 	if ((!pces.empty()) && (len < 30)) {
 		// Only store short strings in the cache so it doesn't churn with
 		// long comments with only a single comment.
@@ -615,17 +909,44 @@ void PositionCache::MeasureWidths(Surface *surface, ViewStyle &vstyle, unsigned
 		int hashValue = PositionCacheEntry::Hash(styleNumber, s, len);
 		probe = static_cast<int>(hashValue % pces.size());
 		if (pces[probe].Retrieve(styleNumber, s, len, positions)) {
-			return;
+			return true;
 		}
 		int probe2 = static_cast<int>((hashValue * 37) % pces.size());
 		if (pces[probe2].Retrieve(styleNumber, s, len, positions)) {
-			return;
+			return true;
 		}
 		// Not found. Choose the oldest of the two slots to replace
 		if (pces[probe].NewerThan(pces[probe2])) {
 			probe = probe2;
 		}
 	}
+	return false;
+}
+
+void PositionCache::Store(int probe, unsigned int styleNumber, const char *s, unsigned int len,
+	const XYPOSITION *positions) {
+	if (probe >= 0) {
+		clock++;
+		if (clock > 60000) {
+			// Since there are only 16 bits for the clock, wrap it round and
+			// reset all cache entries so none get stuck with a high clock.
+			for (size_t i=0; i<pces.size(); i++) {
+				pces[i].ResetClock();
+			}
+			clock = 2;
+		}
+		pces[probe].Set(styleNumber, s, len, positions, clock);
+	}
+}
+
+void PositionCache::MeasureWidths(Surface *surface, ViewStyle &vstyle, unsigned int styleNumber,
+	const char *s, unsigned int len, XYPOSITION *positions, Document *pdoc) {
+
+	allClear = false;
+	int probe = -1;
+	if (Retrieve(styleNumber, s, len, positions, probe)) {
+		return;
+	}
 	if (len > BreakFinder::lengthStartSubdivision) {
 		// Break up into segments
 		unsigned int startSegment = 0;
@@ -642,16 +963,84 @@ void PositionCache::MeasureWidths(Surface *surface, ViewStyle &vstyle, unsigned
 	} else {
 		surface->MeasureWidths(vstyle.styles[styleNumber].font, s, len, positions);
 	}
-	if (probe >= 0) {
-		clock++;
-		if (clock > 60000) {
-			// Since there are only 16 bits for the clock, wrap it round and
-			// reset all cache entries so none get stuck with a high clock.
-			for (size_t i=0; i<pces.size(); i++) {
-				pces[i].ResetClock();
+	Store(probe, styleNumber, s, len, positions);
+}
+
+/**
+ * Measure contiguous segments that share a font with one call to the surface
+ * then make the positions of each segment relative to its start.
+ * Segments are only joined at spaces so each is measured as it is drawn on its own
+ * and can be cached.
+ */
+void PositionCache::MeasureBatch(Surface *surface, ViewStyle &vstyle, const char *s, const unsigned char *styles,
+	const std::vector<TextSegment> &batch, const std::vector<int> &probes, XYPOSITION *positions, Document *pdoc) {
+	const TextSegment &first = batch.front();
+	if (batch.size() == 1) {
+		const unsigned int styleNumber = styles[first.start];
+		if ((first.length == 1) && (s[first.start] == ' ')) {
+			positions[first.start] = vstyle.styles[styleNumber].spaceWidth;
+		} else {
+			MeasureWidths(surface, vstyle, styleNumber, s + first.start, first.length, positions + first.start, pdoc);
+		}
+		return;
+	}
+	const int lenBatch = batch.back().end() - first.start;
+	surface->MeasureWidths(vstyle.styles[styles[first.start]].font, s + first.start, lenBatch,
+		positions + first.start);
+	XYPOSITION xStartSegment = 0;
+	for (size_t i = 0; i < batch.size(); i++) {
+		const TextSegment &ts = batch[i];
+		const XYPOSITION xEndSegment = positions[ts.end() - 1];
+		for (int inSeg = ts.start; inSeg < ts.end(); inSeg++) {
+			positions[inSeg] -= xStartSegment;
+		}
+		xStartSegment = xEndSegment;
+		Store(probes[i], styles[ts.start], s + ts.start, ts.length, positions + ts.start);
+	}
+}
+
+// Kerning and shaping do not reach across a space so text either side of a boundary
+// next to a space measures the same together as apart.
+static inline bool BoundaryAtSpace(const char *s, int position) {
+	return IsSpaceOrTab(s[position - 1]) || IsSpaceOrTab(s[position]);
+}
+
+/**
+ * Measure the text segments of a line, placing the positions of each segment
+ * relative to its start at positions + segment.start.
+ * Per-call overhead on some platforms is high so segments that are not cached and
+ * that are adjacent with the same font, meeting at a space, are measured together.
+ */
+void PositionCache::MeasureSegments(Surface *surface, ViewStyle &vstyle, const char *s, const unsigned char *styles,
+	const std::vector<TextSegment> &segments, XYPOSITION *positions, Document *pdoc) {
+	allClear = false;
+	std::vector<TextSegment> batch;
+	std::vector<int> probes;
+	FontID fontBatch = 0;
+	for (size_t i = 0; i < segments.size(); i++) {
+		const TextSegment &ts = segments[i];
+		const unsigned int styleNumber = styles[ts.start];
+		int probe = -1;
+		if (Retrieve(styleNumber, s + ts.start, ts.length, positions + ts.start, probe)) {
+			if (!batch.empty()) {
+				MeasureBatch(surface, vstyle, s, styles, batch, probes, positions, pdoc);
+				batch.clear();
+				probes.clear();
 			}
-			clock = 2;
+			continue;
 		}
-		pces[probe].Set(styleNumber, s, len, positions, clock);
+		const FontID fontSegment = vstyle.styles[styleNumber].font.GetID();
+		if (!batch.empty() && ((batch.back().end() != ts.start) || (fontBatch != fontSegment) ||
+			!BoundaryAtSpace(s, ts.start) || (ts.end() - batch.front().start > lengthMeasureBatch))) {
+			MeasureBatch(surface, vstyle, s, styles, batch, probes, positions, pdoc);
+			batch.clear();
+			probes.clear();
+		}
+		fontBatch = fontSegment;
+		batch.push_back(ts);
+		probes.push_back(probe);
+	}
+	if (!batch.empty()) {
+		MeasureBatch(surface, vstyle, s, styles, batch, probes, positions, pdoc);
 	}
 }
@@ -16,6 +16,32 @@ static inline bool IsEOLChar(char ch) {
 	return (ch == '\r') || (ch == '\n');
 }
 
+/**
+ * Sparse index of the x position of checkpoints along a long line.
+ * The widths of the chunks between checkpoints are estimated until measured and are
+ * held in a Fenwick tree so the x of a checkpoint and the chunk at an x are found in O(log n).
+ */
+class LongLineIndex {
+	std::vector<int> starts;	// Byte offset of each checkpoint with an extra element for the line end
+	std::vector<XYACCUMULATOR> widths;
+	std::vector<XYACCUMULATOR> tree;
+	std::vector<bool> measured;
+public:
+	// Checkpoints are placed at the first character boundary after each lengthChunk bytes
+	enum { lengthChunk = 4096 };
+	void Clear();
+	bool Empty() const { return widths.empty(); }
+	void Allocate(const std::vector<int> &starts_, const std::vector<XYACCUMULATOR> &widths_);
+	int Chunks() const { return static_cast<int>(widths.size()); }
+	int ChunkStart(int chunk) const { return starts[chunk]; }
+	int ChunkFromPosition(int position) const;
+	XYACCUMULATOR XFromChunk(int chunk) const;
+	int ChunkFromX(XYACCUMULATOR x) const;
+	bool Measured(int chunk) const { return measured[chunk]; }
+	XYACCUMULATOR Width(int chunk) const { return widths[chunk]; }
+	void SetMeasured(int chunk, XYACCUMULATOR width);
+};
+
 /**
  */
 class LineLayout {
@@ -26,6 +52,16 @@ private:
 	/// Drawing is only performed for @a maxLineLength characters on each line.
 	int lineNumber;
 	bool inCache;
+	// Least recently used list maintained by LineLayoutCache
+	LineLayout *lruPrev;
+	LineLayout *lruNext;
+	size_t bytesAccounted;
+	// Compact form of positions: deltas in 1/compactScale pixel units with
+	// compactEscape marking a delta held at full precision in positionsWide.
+	enum { compactScale = 1024, compactEscape = 0xffff };
+	unsigned short *positionsCompact;
+	int lenPositionsCompact;
+	std::vector<XYPOSITION> positionsWide;
 public:
 	enum { wrapWidthInfinite = 0x7ffffff };
 	int maxLineLength;
@@ -53,6 +89,12 @@ public:
 	int lines;
 	XYPOSITION wrapIndent; // In pixels
 
+	// Long line support: only chunks between xWindowStart and xWindowEnd were measured
+	bool windowed;
+	XYACCUMULATOR xWindowStart;
+	XYACCUMULATOR xWindowEnd;
+	LongLineIndex longLine;
+
 	LineLayout(int maxLineLength_);
 	virtual ~LineLayout();
 	void Resize(int maxLineLength_);
@@ -67,6 +109,10 @@ public:
 	void RestoreBracesHighlight(Range rangeLine, Position braces[], bool ignoreStyle);
 	int FindBefore(XYPOSITION x, int lower, int upper) const;
 	int EndLineStyle() const;
+	bool Compact();
+	void Expand();
+	bool IsCompact() const { return positionsCompact != 0; }
+	size_t MemoryUsage() const;
 };
 
 /**
@@ -77,8 +123,17 @@ class LineLayoutCache {
 	bool allInvalidated;
 	int styleClock;
 	int useCount;
+	size_t memoryLimit;
+	size_t memoryUsed;
+	LineLayout *lruFirst;
+	LineLayout *lruLast;
 	void Allocate(size_t length_);
 	void AllocateForLevel(int linesOnScreen, int linesInDoc);
+	void Link(LineLayout *ll);
+	void Unlink(LineLayout *ll);
+	void Account(LineLayout *ll);
+	void Remove(size_t pos);
+	void EnforceMemoryLimit();
 public:
 	LineLayoutCache();
 	virtual ~LineLayoutCache();
@@ -92,11 +147,53 @@ public:
 	void Invalidate(LineLayout::validLevel validity_);
 	void SetLevel(int level_);
 	int GetLevel() const { return level; }
+	void SetMemoryLimit(size_t memoryLimit_);
+	size_t GetMemoryLimit() const { return memoryLimit; }
+	size_t MemoryUsed() const { return memoryUsed; }
 	LineLayout *Retrieve(int lineNumber, int lineCaret, int maxChars, int styleClock_,
 		int linesOnScreen, int linesInDoc);
 	void Dispose(LineLayout *ll);
 };
 
+/**
+ * A rendered line of text retained so that it can be copied to the window
+ * again without being laid out and drawn.
+ */
+class LineTile {
+public:
+	int xOffset;
+	int width;
+	int height;
+	XYPOSITION widthLine;
+	Surface *surface;
+	LineTile() : xOffset(0), width(0), height(0), widthLine(0), surface(0) {
+	}
+};
+
+/**
+ * Rendered lines keyed by document line and sub line.
+ */
+class LineTileCache {
+	typedef std::map<std::pair<int, int>, LineTile> MapTile;
+	bool active;
+	MapTile tiles;
+	void Erase(MapTile::iterator first, MapTile::iterator last);
+	// Private so LineTileCache objects can not be copied
+	LineTileCache(const LineTileCache &);
+public:
+	LineTileCache();
+	~LineTileCache();
+	void SetActive(bool active_);
+	bool Active() const { return active; }
+	void Clear();
+	void InvalidateLines(int lineFirst, int lineLast);
+	void Trim(int lineFirst, int lineLast);
+	size_t Count() const { return tiles.size(); }
+	const LineTile *Find(int lineDoc, int subLine, int xOffset, int width, int height) const;
+	Surface *Store(int lineDoc, int subLine, int xOffset, int width, int height, XYPOSITION widthLine,
+		Surface *surfaceWindow, WindowID wid, int technology);
+};
+
 class PositionCacheEntry {
 	unsigned int styleNumber:8;
 	unsigned int len:8;
@@ -105,7 +202,7 @@ class PositionCacheEntry {
 public:
 	PositionCacheEntry();
 	~PositionCacheEntry();
-	void Set(unsigned int styleNumber_, const char *s_, unsigned int len_, XYPOSITION *positions_, unsigned int clock);
+	void Set(unsigned int styleNumber_, const char *s_, unsigned int len_, const XYPOSITION *positions_, unsigned int clock);
 	void Clear();
 	bool Retrieve(unsigned int styleNumber_, const char *s_, unsigned int len_, XYPOSITION *positions_) const;
 	static int Hash(unsigned int styleNumber_, const char *s, unsigned int len);
@@ -182,7 +279,13 @@ class PositionCache {
 	bool allClear;
 	// Private so PositionCache objects can not be copied
 	PositionCache(const PositionCache &);
+	bool Retrieve(unsigned int styleNumber, const char *s, unsigned int len, XYPOSITION *positions, int &probe) const;
+	void Store(int probe, unsigned int styleNumber, const char *s, unsigned int len, const XYPOSITION *positions);
+	void MeasureBatch(Surface *surface, ViewStyle &vstyle, const char *s, const unsigned char *styles,
+		const std::vector<TextSegment> &batch, const std::vector<int> &probes, XYPOSITION *positions, Document *pdoc);
 public:
+	// Maximum number of bytes measured in one call to the surface
+	enum { lengthMeasureBatch = 4000 };
 	PositionCache();
 	~PositionCache();
 	void Clear();
@@ -190,6 +293,8 @@ public:
 	size_t GetSize() const { return pces.size(); }
 	void MeasureWidths(Surface *surface, ViewStyle &vstyle, unsigned int styleNumber,
 		const char *s, unsigned int len, XYPOSITION *positions, Document *pdoc);
+	void MeasureSegments(Surface *surface, ViewStyle &vstyle, const char *s, const unsigned char *styles,
+		const std::vector<TextSegment> &segments, XYPOSITION *positions, Document *pdoc);
 };
 
 inline bool IsSpaceOrTab(int ch) {
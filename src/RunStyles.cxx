@@ -10,6 +10,7 @@
 #include <stdarg.h>
 
 #include <stdexcept>
+#include <vector>
 #include <algorithm>
 
 #include "Platform.h"
@@ -164,6 +165,94 @@ bool RunStyles::FillRange(int &position, int value, int &fillLength) {
 	}
 }
 
+// Fill many ranges given as triples of position, length and value.
+// When the ranges are in order and do not overlap, the runs they cover are rebuilt in one pass
+// instead of splitting and merging runs for each range.
+// Triples that are empty or extend outside the text are ignored.
+static bool ValidFill(const int *fill, int length) {
+	return (fill[1] > 0) && (fill[0] >= 0) && (fill[0] + fill[1] <= length);
+}
+
+bool RunStyles::FillRanges(int ranges, const int *fills) {
+	const int length = Length();
+	int regionStart = length;
+	int regionEnd = 0;
+	bool ordered = true;
+	for (int range = 0; range < ranges; range++) {
+		const int *fill = fills + range * 3;
+		if (ValidFill(fill, length)) {
+			if (fill[0] < regionEnd)
+				ordered = false;
+			regionStart = std::min(regionStart, fill[0]);
+			regionEnd = fill[0] + fill[1];
+		}
+	}
+	if (!ordered) {
+		bool changed = false;
+		for (int range = 0; range < ranges; range++) {
+			const int *fill = fills + range * 3;
+			if (ValidFill(fill, length)) {
+				int position = fill[0];
+				int fillLength = fill[1];
+				if (FillRange(position, fill[2], fillLength))
+					changed = true;
+			}
+		}
+		return changed;
+	}
+	if (regionStart >= regionEnd)
+		return false;
+
+	// Values for the region as runs with boundaries at its start and end
+	const int runFirst = SplitRun(regionStart);
+	const int runLast = (regionEnd < length) ? SplitRun(regionEnd) : starts->Partitions();
+	std::vector<int> runStarts;
+	std::vector<int> runValues;
+	int run = runFirst;
+	int position = regionStart;
+	for (int range = 0; range < ranges; range++) {
+		const int *fill = fills + range * 3;
+		if (!ValidFill(fill, length))
+			continue;
+		// Text between the ranges keeps its values
+		while (position < fill[0]) {
+			while (starts->PositionFromPartition(run + 1) <= position)
+				run++;
+			if (runValues.empty() || (runValues.back() != styles->ValueAt(run))) {
+				runStarts.push_back(position);
+				runValues.push_back(styles->ValueAt(run));
+			}
+			position = std::min(starts->PositionFromPartition(run + 1), fill[0]);
+		}
+		if (runValues.empty() || (runValues.back() != fill[2])) {
+			runStarts.push_back(fill[0]);
+			runValues.push_back(fill[2]);
+		}
+		position = fill[0] + fill[1];
+	}
+
+	bool changed = (runLast - runFirst) != static_cast<int>(runStarts.size());
+	for (size_t i = 0; !changed && (i < runStarts.size()); i++) {
+		changed = (starts->PositionFromPartition(runFirst + static_cast<int>(i)) != runStarts[i]) ||
+			(styles->ValueAt(runFirst + static_cast<int>(i)) != runValues[i]);
+	}
+	if (changed) {
+		// Keep the first run so the run at position 0 is never removed
+		styles->SetValueAt(runFirst, runValues[0]);
+		for (int runOld = runFirst + 1; runOld < runLast; runOld++) {
+			RemoveRun(runFirst + 1);
+		}
+		for (size_t i = 1; i < runStarts.size(); i++) {
+			starts->InsertPartition(runFirst + static_cast<int>(i), runStarts[i]);
+			styles->InsertValue(runFirst + static_cast<int>(i), 1, runValues[i]);
+		}
+	}
+	// Merge with the runs before and after the region when they have the same value
+	RemoveRunIfSameAsPrevious(runFirst + static_cast<int>(runStarts.size()));
+	RemoveRunIfSameAsPrevious(runFirst);
+	return changed;
+}
+
 void RunStyles::SetValueAt(int position, int value) {
 	int len = 1;
 	FillRange(position, value, len);
@@ -35,6 +35,7 @@ public:
 	int EndRun(int position) const;
 	// Returns true if some values may have changed
 	bool FillRange(int &position, int value, int &fillLength);
+	bool FillRanges(int ranges, const int *fills);
 	void SetValueAt(int position, int value);
 	void InsertSpace(int position, int insertLength);
 	void DeleteAll();
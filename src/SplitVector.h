@@ -279,6 +279,25 @@ public:
 		}
 	}
 
+	/// Retrieve a pointer to the part of the buffer before or after the gap that contains
+	/// position without moving the gap. The pointer is to the element at start and the
+	/// part extends to end.
+	const T *SegmentPointer(int position, int &start, int &end) const {
+		if (position < part1Length) {
+			start = 0;
+			end = part1Length;
+			return body;
+		} else {
+			start = part1Length;
+			end = lengthBody;
+			return body + part1Length + gapLength;
+		}
+	}
+
+	T *SegmentPointer(int position, int &start, int &end) {
+		return const_cast<T *>(static_cast<const SplitVector<T> *>(this)->SegmentPointer(position, start, end));
+	}
+
 	int GapPosition() const {
 		return part1Length; 
 	}
@@ -172,6 +172,8 @@ ViewStyle::ViewStyle(const ViewStyle &source) {
 	wrapVisualFlagsLocation = source.wrapVisualFlagsLocation;
 	wrapVisualStartIndent = source.wrapVisualStartIndent;
 	wrapIndentMode = source.wrapIndentMode;
+
+	longLineThreshold = source.longLineThreshold;
 }
 
 ViewStyle::~ViewStyle() {
@@ -294,6 +296,8 @@ void ViewStyle::Init(size_t stylesSize_) {
 	wrapVisualFlagsLocation = 0;
 	wrapVisualStartIndent = 0;
 	wrapIndentMode = SC_WRAPINDENT_FIXED;
+
+	longLineThreshold = 0;
 }
 
 void ViewStyle::Refresh(Surface &surface, int tabInChars) {
@@ -154,6 +154,9 @@ public:
 	int wrapVisualStartIndent;
 	int wrapIndentMode; // SC_WRAPINDENT_FIXED, _SAME, _INDENT
 
+	// Long line support
+	int longLineThreshold; // lines longer than this are only measured near the visible area, 0 to disable
+
 	ViewStyle();
 	ViewStyle(const ViewStyle &source);
 	~ViewStyle();
@@ -0,0 +1,443 @@
+// Lexer throughput benchmark
+/** @file benchLexers.cxx
+ ** Lex and fold example files and generated corpora without a GUI, reporting
+ ** time, throughput and allocations for each phase.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "PropSetSimple.h"
+#include "LexerModule.h"
+#include "Catalogue.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+
+#include "benchSupport.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+struct LanguageSetting {
+	const char *lexerName;
+	const char *keywords;
+};
+
+static const LanguageSetting languages[] = {
+	{"e8s",
+		"процедура конецпроцедуры функция конецфункции если тогда иначеесли иначе конецесли "
+		"для каждого из по цикл конеццикла пока возврат новый перем экспорт и или не "
+		"истина ложь неопределено "
+		"procedure endprocedure function endfunction if then elsif else endif "
+		"for each in to do enddo while return new var export and or not true false undefined"},
+	{"cpp", "bool break case char class const continue default delete do double else enum "
+		"false float for if int long namespace new private protected public return short "
+		"static struct switch template this true typedef unsigned void while"},
+	{"hypertext", "a body div head html li p script span style table td title tr ul"},
+	{"sql", "and as by create delete from group having insert into join left not null on "
+		"or order select set table update values where"},
+	{"d", "auto break class else enum for foreach if import int module return struct void while"},
+	{"lua", "and break do else elseif end false for function if in local nil not or "
+		"repeat return then true until while"},
+	{"perl", "else elsif for foreach if my package return sub unless use while"},
+	{"python", "and as class def elif else for from if import in is lambda not or pass "
+		"return while with yield"},
+	{"ruby", "begin class def do else elsif end if module return then unless until while"},
+	{"vb", "as dim else end for function if loop next private public sub then while"},
+};
+
+static const LanguageSetting *LanguageFromName(const char *lexerName) {
+	for (size_t i = 0; i < sizeof(languages) / sizeof(languages[0]); i++) {
+		if (strcmp(languages[i].lexerName, lexerName) == 0)
+			return &languages[i];
+	}
+	return 0;
+}
+
+struct ExtensionLexer {
+	const char *extension;
+	const char *lexerName;
+};
+
+static const ExtensionLexer extensionLexers[] = {
+	{"asp", "hypertext"},
+	{"bsl", "e8s"},
+	{"c", "cpp"},
+	{"cpp", "cpp"},
+	{"cxx", "cpp"},
+	{"d", "d"},
+	{"e8s", "e8s"},
+	{"h", "cpp"},
+	{"htm", "hypertext"},
+	{"html", "hypertext"},
+	{"lua", "lua"},
+	{"php", "hypertext"},
+	{"pl", "perl"},
+	{"py", "python"},
+	{"rb", "ruby"},
+	{"sql", "sql"},
+	{"vb", "vb"},
+};
+
+static const char *LexerFromFileName(const std::string &fileName) {
+	const size_t dot = fileName.rfind('.');
+	if (dot != std::string::npos) {
+		const std::string extension = fileName.substr(dot + 1);
+		for (size_t i = 0; i < sizeof(extensionLexers) / sizeof(extensionLexers[0]); i++) {
+			if (extension == extensionLexers[i].extension)
+				return extensionLexers[i].lexerName;
+		}
+	}
+	return 0;
+}
+
+// The files in test/examples, which are small so are mostly a check on per-call overhead.
+static const char *exampleFiles[] = {
+	"x.asp", "x.cxx", "x.d", "x.html", "x.lua", "x.php", "x.pl", "x.py", "x.rb", "x.vb",
+};
+
+static bool ReadFile(const std::string &fileName, std::string &text) {
+	FILE *fp = fopen(fileName.c_str(), "rb");
+	if (!fp)
+		return false;
+	char block[64 * 1024];
+	size_t lenBlock;
+	while ((lenBlock = fread(block, 1, sizeof(block), fp)) > 0) {
+		text.append(block, lenBlock);
+	}
+	fclose(fp);
+	return true;
+}
+
+// Small deterministic generator so corpora are identical on every run and platform.
+class Generator {
+	unsigned int seed;
+public:
+	Generator() : seed(12345) {
+	}
+	int Next(int range) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 16) % range);
+	}
+	const char *Pick(const char * const *words, int count) {
+		return words[Next(count)];
+	}
+};
+
+static const char * const identifiersE8[] = {
+	"Сумма", "Количество", "Товар", "Контрагент", "ТекущаяДата", "Результат",
+	"Запрос", "Выборка", "СтрокаТаблицы", "Документ", "Total", "Index",
+};
+
+static void GenerateE8(Generator &gen, std::string &text, size_t size) {
+	const int countIdentifiers = sizeof(identifiersE8) / sizeof(identifiersE8[0]);
+	while (text.size() < size) {
+		const int procedure = gen.Next(10000);
+		text += "// Расчёт суммы документа по строкам табличной части\n";
+		text += "Процедура Обработать" + std::string(gen.Pick(identifiersE8, countIdentifiers));
+		char number[40];
+		sprintf(number, "%d", procedure);
+		text += number;
+		text += "(Параметр, Знач Флаг = Ложь) Экспорт\n";
+		text += "\tПерем Итог;\n";
+		const int statements = 3 + gen.Next(8);
+		for (int s = 0; s < statements; s++) {
+			const char *id = gen.Pick(identifiersE8, countIdentifiers);
+			switch (gen.Next(4)) {
+			case 0:
+				text += "\tЕсли " + std::string(id) + " > 0 Тогда\n";
+				text += "\t\tИтог = Итог + " + std::string(id) + " * 1.5;\n";
+				text += "\tИначе\n\t\tСообщить(\"Нет данных для \"\"" + std::string(id) + "\"\"\");\n";
+				text += "\tКонецЕсли;\n";
+				break;
+			case 1:
+				text += "\tДля Каждого Строка Из " + std::string(id) + " Цикл\n";
+				text += "\t\tИтог = Итог + Строка.Сумма; // накопление\n";
+				text += "\tКонецЦикла;\n";
+				break;
+			case 2:
+				text += "\t" + std::string(id) + " = Новый Структура(\"Ключ, Значение\", 1, '20140101');\n";
+				break;
+			default:
+				text += "\t#Если Сервер Тогда\n\t" + std::string(id) + " = Неопределено;\n\t#КонецЕсли\n";
+				break;
+			}
+		}
+		text += "\tВозврат;\nКонецПроцедуры\n\n";
+	}
+}
+
+static const char * const identifiersCpp[] = {
+	"count", "position", "lineStart", "buffer", "length", "styleNext", "value", "result",
+};
+
+static void GenerateCpp(Generator &gen, std::string &text, size_t size) {
+	const int countIdentifiers = sizeof(identifiersCpp) / sizeof(identifiersCpp[0]);
+	text += "#include <stdlib.h>\n#include <string.h>\n\n";
+	while (text.size() < size) {
+		char number[40];
+		sprintf(number, "%d", gen.Next(10000));
+		text += "/**\n * Process the data.\n */\n";
+		text += "static int Process" + std::string(number) + "(const char *s, int length) {\n";
+		const int statements = 3 + gen.Next(8);
+		for (int s = 0; s < statements; s++) {
+			const char *id = gen.Pick(identifiersCpp, countIdentifiers);
+			switch (gen.Next(4)) {
+			case 0:
+				text += "\tif (" + std::string(id) + " > 0x1F) {\n\t\t" + id + " += length * 3;\n\t}\n";
+				break;
+			case 1:
+				text += "\tfor (int i = 0; i < length; i++) {\n\t\t" + std::string(id) +
+					" = s[i];\t// Copy the character\n\t}\n";
+				break;
+			case 2:
+				text += "\tconst char *" + std::string(id) + "Text = \"string with \\\"escapes\\\"\\n\";\n";
+				break;
+			default:
+				text += "#ifdef DEBUG\n\tprintf(\"%d\\n\", " + std::string(id) + ");\n#endif\n";
+				break;
+			}
+		}
+		text += "\treturn 0;\n}\n\n";
+	}
+}
+
+static void GenerateHTML(Generator &gen, std::string &text, size_t size) {
+	const int countIdentifiers = sizeof(identifiersCpp) / sizeof(identifiersCpp[0]);
+	text += "<!DOCTYPE html>\n<html>\n<head>\n<title>Corpus</title>\n</head>\n<body>\n";
+	while (text.size() < size) {
+		const char *id = gen.Pick(identifiersCpp, countIdentifiers);
+		switch (gen.Next(4)) {
+		case 0:
+			text += "<div class=\"item\" id=\"" + std::string(id) + "\">\n<p>Some <b>bold</b> text &amp; more.</p>\n</div>\n";
+			break;
+		case 1:
+			text += "<table border=\"1\">\n<tr><td>" + std::string(id) + "</td><td>42</td></tr>\n</table>\n";
+			break;
+		case 2:
+			text += "<script type=\"text/javascript\">\nvar " + std::string(id) +
+				" = document.getElementById('x'); // comment\nif (" + id + ") { " + id + ".value = \"v\"; }\n</script>\n";
+			break;
+		default:
+			text += "<!-- a comment about " + std::string(id) + " -->\n<ul><li><a href=\"#" + id + "\">link</a></li></ul>\n";
+			break;
+		}
+	}
+	text += "</body>\n</html>\n";
+}
+
+static void GenerateSQL(Generator &gen, std::string &text, size_t size) {
+	const int countIdentifiers = sizeof(identifiersCpp) / sizeof(identifiersCpp[0]);
+	while (text.size() < size) {
+		const char *id = gen.Pick(identifiersCpp, countIdentifiers);
+		switch (gen.Next(3)) {
+		case 0:
+			text += "-- Select the rows\nSELECT a." + std::string(id) + ", b.name\nFROM accounts a\n"
+				"LEFT JOIN customers b ON a.id = b.id\nWHERE a." + id + " > 100 AND b.name <> 'x'\nORDER BY 1;\n\n";
+			break;
+		case 1:
+			text += "INSERT INTO log (" + std::string(id) + ", message) VALUES (12.5, 'it''s done');\n";
+			break;
+		default:
+			text += "/* update the totals */\nUPDATE totals SET " + std::string(id) + " = " + id + " + 1 WHERE id IS NOT NULL;\n";
+			break;
+		}
+	}
+}
+
+struct Corpus {
+	std::string name;
+	const char *lexerName;
+	std::string text;
+};
+
+struct PhaseResult {
+	double seconds;
+	AllocationCount allocated;
+	PhaseResult() : seconds(1e9) {
+	}
+	void Record(double seconds_, const AllocationCount &allocated_) {
+		// The fastest repetition is the least disturbed by the rest of the system
+		if (seconds_ < seconds) {
+			seconds = seconds_;
+			allocated = allocated_;
+		}
+	}
+};
+
+// Styles a whole document the way Scintilla does, on several threads when the lexer allows
+class BenchLexInterface : public LexInterface {
+public:
+	BenchLexInterface(Document *pdoc_, ILexer *instance_) : LexInterface(pdoc_) {
+		instance = instance_;
+	}
+};
+
+static double MBPerSecond(size_t bytes, double seconds) {
+	return (seconds > 0) ? (bytes / (1024.0 * 1024.0)) / seconds : 0.0;
+}
+
+static bool Measure(const Corpus &corpus, int repetitions) {
+	const LexerModule *lm = Catalogue::Find(corpus.lexerName);
+	if (!lm) {
+		fprintf(stderr, "No lexer %s for %s\n", corpus.lexerName, corpus.name.c_str());
+		return false;
+	}
+	const LanguageSetting *language = LanguageFromName(corpus.lexerName);
+	PhaseResult load;
+	PhaseResult lex;
+	PhaseResult fold;
+	PhaseResult style;
+	for (int repetition = 0; repetition < repetitions; repetition++) {
+		ILexer *lexer = lm->Create();
+		lexer->PropertySet("fold", "1");
+		lexer->PropertySet("fold.comment", "1");
+		lexer->PropertySet("fold.html", "1");
+		lexer->PropertySet("fold.preprocessor", "1");
+		if (language)
+			lexer->WordListSet(0, language->keywords);
+
+		Document *pdoc = new Document();
+		pdoc->AddRef();
+		pdoc->SetDBCSCodePage(SC_CP_UTF8);
+
+		AllocationCount allocStart = AllocationsSoFar();
+		ElapsedTime et;
+		pdoc->InsertString(0, corpus.text.c_str(), static_cast<int>(corpus.text.length()));
+		load.Record(et.Duration(true), AllocationsSoFar() - allocStart);
+
+		allocStart = AllocationsSoFar();
+		et.Duration(true);
+		lexer->Lex(0, pdoc->Length(), 0, pdoc);
+		lex.Record(et.Duration(true), AllocationsSoFar() - allocStart);
+
+		allocStart = AllocationsSoFar();
+		et.Duration(true);
+		lexer->Fold(0, pdoc->Length(), 0, pdoc);
+		fold.Record(et.Duration(true), AllocationsSoFar() - allocStart);
+
+		Document *pdocStyle = new Document();
+		pdocStyle->AddRef();
+		pdocStyle->SetDBCSCodePage(SC_CP_UTF8);
+		pdocStyle->InsertString(0, corpus.text.c_str(), static_cast<int>(corpus.text.length()));
+		allocStart = AllocationsSoFar();
+		et.Duration(true);
+		BenchLexInterface(pdocStyle, lexer).Colourise(0, -1);
+		style.Record(et.Duration(true), AllocationsSoFar() - allocStart);
+
+		pdocStyle->Release();
+		pdoc->Release();
+		lexer->Release();
+	}
+	const size_t bytes = corpus.text.length();
+	printf("%-24s %-10s %10lu %9.3f %9.3f %9.2f %9.3f %9.2f %8lu %10lu %8lu %10lu %9.3f %9.2f\n",
+		corpus.name.c_str(), corpus.lexerName, static_cast<unsigned long>(bytes),
+		load.seconds * 1000.0,
+		lex.seconds * 1000.0, MBPerSecond(bytes, lex.seconds),
+		fold.seconds * 1000.0, MBPerSecond(bytes, fold.seconds),
+		static_cast<unsigned long>(lex.allocated.allocations), static_cast<unsigned long>(lex.allocated.bytes),
+		static_cast<unsigned long>(fold.allocated.allocations), static_cast<unsigned long>(fold.allocated.bytes),
+		style.seconds * 1000.0, MBPerSecond(bytes, style.seconds));
+	return true;
+}
+
+static void Usage() {
+	fprintf(stderr,
+		"Usage: benchLexers [-examples directory] [-size megabytes] [-repeat count] [file...]\n"
+		"Lexes and folds the example files, generated E8, C++, HTML and SQL corpora of the\n"
+		"given size and any files named on the command line.\n");
+}
+
+int main(int argc, char *argv[]) {
+	std::string examplesDirectory = "../examples";
+	int sizeMB = 4;
+	int repetitions = 3;
+	std::vector<std::string> files;
+	for (int arg = 1; arg < argc; arg++) {
+		if ((strcmp(argv[arg], "-examples") == 0) && (arg + 1 < argc)) {
+			examplesDirectory = argv[++arg];
+		} else if ((strcmp(argv[arg], "-size") == 0) && (arg + 1 < argc)) {
+			sizeMB = atoi(argv[++arg]);
+		} else if ((strcmp(argv[arg], "-repeat") == 0) && (arg + 1 < argc)) {
+			repetitions = std::max(atoi(argv[++arg]), 1);
+		} else if (argv[arg][0] == '-') {
+			Usage();
+			return 1;
+		} else {
+			files.push_back(argv[arg]);
+		}
+	}
+
+	std::vector<Corpus> corpora;
+	for (size_t i = 0; i < sizeof(exampleFiles) / sizeof(exampleFiles[0]); i++) {
+		Corpus corpus;
+		corpus.name = exampleFiles[i];
+		corpus.lexerName = LexerFromFileName(corpus.name);
+		if (ReadFile(examplesDirectory + "/" + exampleFiles[i], corpus.text))
+			corpora.push_back(corpus);
+		else
+			fprintf(stderr, "Can not read %s/%s\n", examplesDirectory.c_str(), exampleFiles[i]);
+	}
+	for (size_t i = 0; i < files.size(); i++) {
+		Corpus corpus;
+		corpus.name = files[i];
+		corpus.lexerName = LexerFromFileName(files[i]);
+		if (!corpus.lexerName) {
+			fprintf(stderr, "No lexer for %s\n", files[i].c_str());
+		} else if (!ReadFile(files[i], corpus.text)) {
+			fprintf(stderr, "Can not read %s\n", files[i].c_str());
+		} else {
+			corpora.push_back(corpus);
+		}
+	}
+	if (sizeMB > 0) {
+		const size_t size = static_cast<size_t>(sizeMB) * 1024 * 1024;
+		typedef void (*GenerateFunction)(Generator &gen, std::string &text, size_t size);
+		const struct {
+			const char *name;
+			const char *lexerName;
+			GenerateFunction generate;
+		} generated[] = {
+			{"generated.e8s", "e8s", GenerateE8},
+			{"generated.cxx", "cpp", GenerateCpp},
+			{"generated.html", "hypertext", GenerateHTML},
+			{"generated.sql", "sql", GenerateSQL},
+		};
+		for (size_t i = 0; i < sizeof(generated) / sizeof(generated[0]); i++) {
+			Corpus corpus;
+			corpus.name = generated[i].name;
+			corpus.lexerName = generated[i].lexerName;
+			Generator gen;
+			generated[i].generate(gen, corpus.text, size);
+			corpora.push_back(corpus);
+		}
+	}
+
+	printf("# %-22s %-10s %10s %9s %9s %9s %9s %9s %8s %10s %8s %10s %9s %9s\n",
+		"corpus", "lexer", "bytes", "load_ms", "lex_ms", "lex_MB/s", "fold_ms", "fold_MB/s",
+		"lex_new", "lex_bytes", "fold_new", "fold_bytes", "style_ms", "style_MB/s");
+	bool succeeded = true;
+	for (size_t i = 0; i < corpora.size(); i++) {
+		succeeded = Measure(corpora[i], repetitions) && succeeded;
+	}
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,389 @@
+// Data structure benchmark
+/** @file benchStructures.cxx
+ ** Time the core data structures under sequential and random workloads over a range of sizes.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "ContractionState.h"
+
+#include "benchSupport.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+// Small deterministic generator so workloads are identical on every run and platform.
+class Generator {
+	unsigned int seed;
+public:
+	Generator() : seed(12345) {
+	}
+	int Next(int range) {
+		seed = seed * 1103515245 + 12345;
+		const unsigned int high = seed >> 16;
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>(((high << 15) ^ (seed >> 16)) % static_cast<unsigned int>(range));
+	}
+};
+
+/// Result of one workload: the operations are timed, the check value depends on every
+/// operation so it can not be optimized away and it should match between implementations.
+struct Result {
+	int operations;
+	unsigned int check;
+	Result() : operations(0), check(0) {
+	}
+};
+
+typedef Result (*Workload)(int size, int operations);
+
+// SplitVector
+
+static Result SplitVectorAppend(int size, int) {
+	Result result;
+	SplitVector<int> sv;
+	for (int i = 0; i < size; i++) {
+		sv.Insert(sv.Length(), i);
+	}
+	result.operations = size;
+	result.check = sv.ValueAt(size / 2);
+	return result;
+}
+
+static Result SplitVectorInsertRandom(int size, int operations) {
+	Result result;
+	SplitVector<int> sv;
+	sv.InsertValue(0, size, 1);
+	Generator gen;
+	for (int i = 0; i < operations; i++) {
+		sv.Insert(gen.Next(sv.Length() + 1), i);
+	}
+	result.operations = operations;
+	result.check = sv.ValueAt(size / 2) + sv.Length();
+	return result;
+}
+
+static Result SplitVectorDeleteRandom(int size, int operations) {
+	Result result;
+	SplitVector<int> sv;
+	sv.InsertValue(0, size + operations, 1);
+	Generator gen;
+	for (int i = 0; i < operations; i++) {
+		sv.Delete(gen.Next(sv.Length()));
+	}
+	result.operations = operations;
+	result.check = sv.Length();
+	return result;
+}
+
+static Result SplitVectorTyping(int size, int operations) {
+	// Insertions clustered around a slowly moving point as when typing
+	Result result;
+	SplitVector<int> sv;
+	sv.InsertValue(0, size, 1);
+	Generator gen;
+	int position = size / 2;
+	for (int i = 0; i < operations; i++) {
+		if ((i % 64) == 0)
+			position = gen.Next(sv.Length());
+		sv.Insert(position++, i);
+	}
+	result.operations = operations;
+	result.check = sv.ValueAt(size / 3) + sv.Length();
+	return result;
+}
+
+// Partitioning
+
+static void FillPartitioning(Partitioning &partitioning, int size) {
+	// Partitions of 40 positions each appended as when loading lines of text
+	for (int i = 1; i <= size; i++) {
+		partitioning.InsertText(i - 1, 40);
+		partitioning.InsertPartition(i, i * 40);
+	}
+}
+
+static Result PartitioningBuild(int size, int) {
+	Result result;
+	Partitioning partitioning(8);
+	FillPartitioning(partitioning, size);
+	result.operations = size;
+	result.check = partitioning.Partitions();
+	return result;
+}
+
+static Result PartitioningLookup(int size, int operations) {
+	Result result;
+	Partitioning partitioning(8);
+	FillPartitioning(partitioning, size);
+	const int length = partitioning.PositionFromPartition(partitioning.Partitions());
+	Generator gen;
+	for (int i = 0; i < operations; i++) {
+		result.check += partitioning.PartitionFromPosition(gen.Next(length));
+	}
+	result.operations = operations;
+	return result;
+}
+
+static Result PartitioningInsertText(int size, int operations) {
+	// Text inserted at random lines, so the step moves around
+	Result result;
+	Partitioning partitioning(8);
+	FillPartitioning(partitioning, size);
+	Generator gen;
+	for (int i = 0; i < operations; i++) {
+		partitioning.InsertText(gen.Next(partitioning.Partitions()), 1);
+	}
+	result.operations = operations;
+	result.check = partitioning.PositionFromPartition(partitioning.Partitions());
+	return result;
+}
+
+static Result PartitioningInsertRemove(int size, int operations) {
+	Result result;
+	Partitioning partitioning(8);
+	FillPartitioning(partitioning, size);
+	Generator gen;
+	for (int i = 0; i < operations; i++) {
+		const int partition = 1 + gen.Next(partitioning.Partitions() - 1);
+		if (i % 2) {
+			partitioning.RemovePartition(partition);
+		} else {
+			const int start = partitioning.PositionFromPartition(partition);
+			partitioning.InsertPartition(partition + 1, start + 1);
+		}
+	}
+	result.operations = operations;
+	result.check = partitioning.Partitions();
+	return result;
+}
+
+// RunStyles
+
+static Result RunStylesFillRandom(int size, int operations) {
+	// A storm of short fills as from an indicator being set on search matches
+	Result result;
+	RunStyles rs;
+	rs.InsertSpace(0, size);
+	Generator gen;
+	for (int i = 0; i < operations; i++) {
+		int position = gen.Next(size);
+		int fillLength = 1 + gen.Next(20);
+		if (position + fillLength > size)
+			fillLength = size - position;
+		if (rs.FillRange(position, 1 + (i % 3), fillLength))
+			result.check++;
+	}
+	result.operations = operations;
+	result.check += rs.Runs();
+	return result;
+}
+
+static Result RunStylesFillSequential(int size, int operations) {
+	Result result;
+	RunStyles rs;
+	rs.InsertSpace(0, size);
+	const int step = std::max(size / operations, 2);
+	int ops = 0;
+	for (int start = 0; (start < size) && (ops < operations); start += step, ops++) {
+		int position = start;
+		int fillLength = step / 2;
+		if (position + fillLength > size)
+			fillLength = size - position;
+		rs.FillRange(position, 1, fillLength);
+	}
+	result.operations = ops;
+	result.check = rs.Runs();
+	return result;
+}
+
+static Result RunStylesValueAt(int size, int operations) {
+	Result result;
+	RunStyles rs;
+	rs.InsertSpace(0, size);
+	Generator gen;
+	for (int i = 0; i < 1000; i++) {
+		int position = gen.Next(size);
+		int fillLength = 1 + gen.Next(100);
+		if (position + fillLength > size)
+			fillLength = size - position;
+		rs.FillRange(position, 1, fillLength);
+	}
+	for (int i = 0; i < operations; i++) {
+		result.check += rs.ValueAt(gen.Next(size));
+	}
+	result.operations = operations;
+	return result;
+}
+
+// ContractionState
+
+static Result ContractionFoldSweep(int size, int operations) {
+	// Fold and then unfold blocks of 10 lines spread through the document
+	Result result;
+	ContractionState cs;
+	cs.InsertLines(0, size);
+	const int blocks = std::min(operations / 2, size / 12);
+	const int stride = size / std::max(blocks, 1);
+	for (int block = 0; block < blocks; block++) {
+		const int header = block * stride;
+		cs.SetExpanded(header, false);
+		cs.SetVisible(header + 1, header + 10, false);
+	}
+	result.check = cs.LinesDisplayed();
+	for (int block = 0; block < blocks; block++) {
+		const int header = block * stride;
+		cs.SetExpanded(header, true);
+		cs.SetVisible(header + 1, header + 10, true);
+	}
+	result.operations = blocks * 2;
+	result.check += cs.LinesDisplayed();
+	return result;
+}
+
+static Result ContractionDisplayFromDoc(int size, int operations) {
+	Result result;
+	ContractionState cs;
+	cs.InsertLines(0, size);
+	const int blocks = std::min(1000, size / 12);
+	const int stride = size / std::max(blocks, 1);
+	for (int block = 0; block < blocks; block++) {
+		cs.SetVisible(block * stride + 1, block * stride + 10, false);
+	}
+	Generator gen;
+	for (int i = 0; i < operations; i++) {
+		result.check += cs.DisplayFromDoc(gen.Next(size));
+	}
+	result.operations = operations;
+	return result;
+}
+
+static Result ContractionWrapHeights(int size, int operations) {
+	// Line heights changing as when wrapping is being calculated
+	Result result;
+	ContractionState cs;
+	cs.InsertLines(0, size);
+	Generator gen;
+	for (int i = 0; i < operations; i++) {
+		if (cs.SetHeight(gen.Next(size), 1 + gen.Next(3)))
+			result.check++;
+	}
+	result.operations = operations;
+	result.check += cs.LinesDisplayed();
+	return result;
+}
+
+struct Benchmark {
+	const char *structure;
+	const char *workload;
+	Workload function;
+	bool quadratic;	// Each operation is proportional to size so limit operations
+};
+
+static const Benchmark benchmarks[] = {
+	{"SplitVector", "append", SplitVectorAppend, false},
+	{"SplitVector", "insert-random", SplitVectorInsertRandom, true},
+	{"SplitVector", "delete-random", SplitVectorDeleteRandom, true},
+	{"SplitVector", "insert-typing", SplitVectorTyping, true},
+	{"Partitioning", "build", PartitioningBuild, false},
+	{"Partitioning", "lookup", PartitioningLookup, false},
+	{"Partitioning", "insert-text", PartitioningInsertText, true},
+	{"Partitioning", "insert-remove", PartitioningInsertRemove, true},
+	{"RunStyles", "fill-random", RunStylesFillRandom, true},
+	{"RunStyles", "fill-sequential", RunStylesFillSequential, true},
+	{"RunStyles", "value-at", RunStylesValueAt, false},
+	{"ContractionState", "fold-sweep", ContractionFoldSweep, true},
+	{"ContractionState", "display-from-doc", ContractionDisplayFromDoc, false},
+	{"ContractionState", "wrap-heights", ContractionWrapHeights, true},
+};
+
+static void Usage() {
+	fprintf(stderr,
+		"Usage: benchStructures [-min size] [-max size] [-operations count] [-repeat count] [-csv] [name...]\n"
+		"Sizes run in powers of 10 from -min (default 1000) to -max (default 1000000).\n"
+		"Names select benchmarks whose structure or workload contains the name.\n");
+}
+
+int main(int argc, char *argv[]) {
+	int sizeMin = 1000;
+	int sizeMax = 1000000;
+	int operations = 100000;
+	int repetitions = 3;
+	bool csv = false;
+	std::vector<std::string> names;
+	for (int arg = 1; arg < argc; arg++) {
+		if ((strcmp(argv[arg], "-min") == 0) && (arg + 1 < argc)) {
+			sizeMin = atoi(argv[++arg]);
+		} else if ((strcmp(argv[arg], "-max") == 0) && (arg + 1 < argc)) {
+			sizeMax = atoi(argv[++arg]);
+		} else if ((strcmp(argv[arg], "-operations") == 0) && (arg + 1 < argc)) {
+			operations = std::max(atoi(argv[++arg]), 1);
+		} else if ((strcmp(argv[arg], "-repeat") == 0) && (arg + 1 < argc)) {
+			repetitions = std::max(atoi(argv[++arg]), 1);
+		} else if (strcmp(argv[arg], "-csv") == 0) {
+			csv = true;
+		} else if (argv[arg][0] == '-') {
+			Usage();
+			return 1;
+		} else {
+			names.push_back(argv[arg]);
+		}
+	}
+
+	if (csv)
+		printf("structure,workload,size,operations,seconds,ns_per_op,allocations,check\n");
+	else
+		printf("# %-16s %-16s %9s %10s %10s %10s %11s %11s\n",
+			"structure", "workload", "size", "operations", "seconds", "ns_per_op", "allocations", "check");
+	for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+		const Benchmark &benchmark = benchmarks[b];
+		bool selected = names.empty();
+		for (size_t n = 0; n < names.size(); n++) {
+			if (strstr(benchmark.structure, names[n].c_str()) || strstr(benchmark.workload, names[n].c_str()))
+				selected = true;
+		}
+		if (!selected)
+			continue;
+		for (int size = sizeMin; (size > 0) && (size <= sizeMax); size *= 10) {
+			// Random edits on the largest structures cost a move of the whole gap each
+			const int ops = benchmark.quadratic ? std::min(operations, std::max(1000, 1000000000 / size)) : operations;
+			double best = 1e9;
+			Result result;
+			AllocationCount allocated;
+			for (int repetition = 0; repetition < repetitions; repetition++) {
+				const AllocationCount allocStart = AllocationsSoFar();
+				ElapsedTime et;
+				result = benchmark.function(size, ops);
+				const double duration = et.Duration();
+				if (duration < best) {
+					best = duration;
+					allocated = AllocationsSoFar() - allocStart;
+				}
+			}
+			const double nsPerOperation = (result.operations > 0) ? best * 1e9 / result.operations : 0.0;
+			if (csv)
+				printf("%s,%s,%d,%d,%.6f,%.1f,%lu,%u\n", benchmark.structure, benchmark.workload,
+					size, result.operations, best, nsPerOperation,
+					static_cast<unsigned long>(allocated.allocations), result.check);
+			else
+				printf("%-18s %-16s %9d %10d %10.6f %10.1f %11lu %11u\n", benchmark.structure, benchmark.workload,
+					size, result.operations, best, nsPerOperation,
+					static_cast<unsigned long>(allocated.allocations), result.check);
+			fflush(stdout);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,136 @@
+// Support code for Scintilla benchmarks
+/** @file benchSupport.cxx
+ ** Platform functions needed by the tested code, timing and allocation counting.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <new>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "Platform.h"
+
+#include "benchSupport.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+// Only the parts of Platform used by the document and lexers are implemented.
+
+int Platform::Minimum(int a, int b) {
+	return (a < b) ? a : b;
+}
+
+int Platform::Maximum(int a, int b) {
+	return (a > b) ? a : b;
+}
+
+int Platform::Clamp(int val, int minVal, int maxVal) {
+	if (val > maxVal)
+		val = maxVal;
+	if (val < minVal)
+		val = minVal;
+	return val;
+}
+
+void Platform::DebugPrintf(const char *, ...) {
+}
+
+void Platform::Assert(const char *c, const char *file, int line) {
+	fprintf(stderr, "Assertion [%s] failed at %s %d\n", c, file, line);
+	abort();
+}
+
+#ifdef _WIN32
+
+ElapsedTime::ElapsedTime() {
+	LARGE_INTEGER timeVal;
+	::QueryPerformanceCounter(&timeVal);
+	bigBit = timeVal.HighPart;
+	littleBit = timeVal.LowPart;
+}
+
+double ElapsedTime::Duration(bool reset) {
+	LARGE_INTEGER frequency;
+	::QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER lEnd;
+	::QueryPerformanceCounter(&lEnd);
+	LARGE_INTEGER lBegin;
+	lBegin.HighPart = bigBit;
+	lBegin.LowPart = littleBit;
+	const double result = static_cast<double>(lEnd.QuadPart - lBegin.QuadPart) /
+		static_cast<double>(frequency.QuadPart);
+	if (reset) {
+		bigBit = lEnd.HighPart;
+		littleBit = lEnd.LowPart;
+	}
+	return result;
+}
+
+#else
+
+ElapsedTime::ElapsedTime() {
+	struct timeval curTime;
+	gettimeofday(&curTime, 0);
+	bigBit = curTime.tv_sec;
+	littleBit = curTime.tv_usec;
+}
+
+double ElapsedTime::Duration(bool reset) {
+	struct timeval curTime;
+	gettimeofday(&curTime, 0);
+	const long endBigBit = curTime.tv_sec;
+	const long endLittleBit = curTime.tv_usec;
+	double result = 1000000.0 * (endBigBit - bigBit);
+	result += endLittleBit - littleBit;
+	result /= 1000000.0;
+	if (reset) {
+		bigBit = endBigBit;
+		littleBit = endLittleBit;
+	}
+	return result;
+}
+
+#endif
+
+// Atomic as documents may be lexed on several threads while allocations are counted
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> bytesAllocated(0);
+
+AllocationCount AllocationsSoFar() {
+	return AllocationCount(allocations.load(), bytesAllocated.load());
+}
+
+static void *Allocate(size_t size) {
+	allocations++;
+	bytesAllocated += size;
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new(size_t size) {
+	return Allocate(size);
+}
+
+void *operator new[](size_t size) {
+	return Allocate(size);
+}
+
+void operator delete(void *p) throw() {
+	free(p);
+}
+
+void operator delete[](void *p) throw() {
+	free(p);
+}
@@ -0,0 +1,25 @@
+// Support code for Scintilla benchmarks
+/** @file benchSupport.h
+ ** Platform functions needed by the tested code, timing and allocation counting.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef BENCHSUPPORT_H
+#define BENCHSUPPORT_H
+
+/// Number and total size of allocations made through operator new since the program started.
+struct AllocationCount {
+	size_t allocations;
+	size_t bytes;
+	AllocationCount() : allocations(0), bytes(0) {
+	}
+	AllocationCount(size_t allocations_, size_t bytes_) : allocations(allocations_), bytes(bytes_) {
+	}
+	AllocationCount operator-(const AllocationCount &other) const {
+		return AllocationCount(allocations - other.allocations, bytes - other.bytes);
+	}
+};
+
+AllocationCount AllocationsSoFar();
+
+#endif
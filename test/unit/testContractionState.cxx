@@ -146,3 +146,59 @@ TEST_F(ContractionStateTest, ChangeHeight) {
 	EXPECT_EQ(2, pcs->GetHeight(1));
 	EXPECT_EQ(1, pcs->GetHeight(2));
 }
+
+TEST_F(ContractionStateTest, ShowHideRange) {
+	pcs->InsertLines(0,100);
+	for (int l=0;l<100;l+=10) {
+		pcs->SetHeight(l, 3);
+	}
+	EXPECT_EQ(121, pcs->LinesDisplayed());
+	EXPECT_EQ(true, pcs->SetVisible(5, 94, false));
+	EXPECT_EQ(false, pcs->SetVisible(5, 94, false));
+	EXPECT_EQ(0, pcs->GetVisible(5));
+	EXPECT_EQ(0, pcs->GetVisible(94));
+	EXPECT_EQ(true, pcs->GetVisible(95));
+	EXPECT_EQ(13, pcs->LinesDisplayed());
+	EXPECT_EQ(7, pcs->DisplayFromDoc(95));
+	EXPECT_EQ(95, pcs->DocFromDisplay(7));
+
+	// Showing part of the range leaves the rest hidden
+	EXPECT_EQ(true, pcs->SetVisible(40, 59, true));
+	EXPECT_EQ(0, pcs->GetVisible(39));
+	EXPECT_EQ(true, pcs->GetVisible(40));
+	EXPECT_EQ(37, pcs->LinesDisplayed());
+	EXPECT_EQ(7, pcs->DisplayFromDoc(40));
+	EXPECT_EQ(19, pcs->DisplayFromDoc(50));
+	EXPECT_EQ(22, pcs->DisplayFromDoc(51));
+	EXPECT_EQ(31, pcs->DisplayFromDoc(95));
+	for (int l=0;l<100;l+=10) {
+		EXPECT_EQ(3, pcs->GetHeight(l));
+	}
+	EXPECT_EQ(true, pcs->SetVisible(0, 99, true));
+	EXPECT_EQ(121, pcs->LinesDisplayed());
+	EXPECT_EQ(0, pcs->HiddenLines());
+}
+
+TEST_F(ContractionStateTest, ShowHideRanges) {
+	pcs->InsertLines(0,20);
+	pcs->SetHeight(6, 2);
+	const int hide[] = {2, 3, 0, 6, 4, 0, 15, 5, 0};
+	EXPECT_EQ(true, pcs->SetVisibleRanges(3, hide));
+	EXPECT_EQ(true, pcs->GetVisible(1));
+	EXPECT_EQ(0, pcs->GetVisible(2));
+	EXPECT_EQ(0, pcs->GetVisible(9));
+	EXPECT_EQ(true, pcs->GetVisible(10));
+	EXPECT_EQ(0, pcs->GetVisible(19));
+	EXPECT_EQ(9, pcs->LinesDisplayed());
+	EXPECT_EQ(3, pcs->DisplayFromDoc(10));
+	EXPECT_EQ(false, pcs->SetVisibleRanges(3, hide));
+
+	const int show[] = {3, 1, 1, 6, 1, 1, 10, 2, 0};
+	EXPECT_EQ(true, pcs->SetVisibleRanges(3, show));
+	EXPECT_EQ(0, pcs->GetVisible(2));
+	EXPECT_EQ(true, pcs->GetVisible(3));
+	EXPECT_EQ(true, pcs->GetVisible(6));
+	EXPECT_EQ(0, pcs->GetVisible(11));
+	EXPECT_EQ(10, pcs->LinesDisplayed());
+	EXPECT_EQ(6, pcs->DisplayFromDoc(12));
+}
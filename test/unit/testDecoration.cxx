@@ -0,0 +1,122 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "Scintilla.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "Decoration.h"
+
+#include <gtest/gtest.h>
+
+// Test DecorationList.
+
+class DecorationListTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pdl = new DecorationList();
+	}
+
+	virtual void TearDown() {
+		delete pdl;
+		pdl = 0;
+	}
+
+	void Fill(int indicator, int position, int value, int fillLength) {
+		pdl->SetCurrentIndicator(indicator);
+		pdl->FillRange(position, value, fillLength);
+	}
+
+	DecorationList *pdl;
+};
+
+TEST_F(DecorationListTest, IsEmptyInitially) {
+	EXPECT_EQ(0, pdl->AllOnFor(0));
+	EXPECT_FALSE(pdl->AnyOn(0, 10));
+}
+
+TEST_F(DecorationListTest, AllOnFor) {
+	pdl->InsertSpace(0, 20);
+	Fill(1, 2, 1, 6);
+	Fill(3, 5, 1, 10);
+	EXPECT_EQ(0, pdl->AllOnFor(1));
+	EXPECT_EQ(0x2, pdl->AllOnFor(2));
+	EXPECT_EQ(0xa, pdl->AllOnFor(5));
+	EXPECT_EQ(0xa, pdl->AllOnFor(7));
+	EXPECT_EQ(0x8, pdl->AllOnFor(8));
+	EXPECT_EQ(0x8, pdl->AllOnFor(14));
+	EXPECT_EQ(0, pdl->AllOnFor(15));
+	Fill(3, 0, 0, 20);
+	EXPECT_EQ(0x2, pdl->AllOnFor(5));
+	EXPECT_EQ(0, pdl->AllOnFor(8));
+}
+
+TEST_F(DecorationListTest, AnyOn) {
+	pdl->InsertSpace(0, 20);
+	Fill(4, 10, 1, 2);
+	EXPECT_FALSE(pdl->AnyOn(0, 10));
+	EXPECT_TRUE(pdl->AnyOn(0, 11));
+	EXPECT_TRUE(pdl->AnyOn(11, 15));
+	EXPECT_FALSE(pdl->AnyOn(12, 20));
+	EXPECT_FALSE(pdl->AnyOn(10, 10));
+}
+
+TEST_F(DecorationListTest, InsertAndDelete) {
+	pdl->InsertSpace(0, 10);
+	Fill(0, 2, 1, 4);
+	Fill(2, 4, 1, 4);
+	// Text inserted inside a run takes that run's indicators
+	pdl->InsertSpace(5, 3);
+	EXPECT_EQ(0x5, pdl->AllOnFor(5));
+	EXPECT_EQ(0x5, pdl->AllOnFor(8));
+	EXPECT_EQ(0x4, pdl->AllOnFor(9));
+	// Text inserted at the end has no indicators
+	pdl->InsertSpace(13, 2);
+	EXPECT_EQ(0, pdl->AllOnFor(13));
+	pdl->DeleteRange(2, 8);
+	EXPECT_EQ(0x4, pdl->AllOnFor(2));
+	EXPECT_EQ(0, pdl->AllOnFor(3));
+	pdl->DeleteRange(0, 7);
+	EXPECT_EQ(0, pdl->AllOnFor(0));
+	EXPECT_FALSE(pdl->AnyOn(0, 1));
+}
+
+TEST_F(DecorationListTest, MatchesValueAt) {
+	int length = 200;
+	pdl->InsertSpace(0, length);
+	unsigned int seed = 1;
+	for (int step = 0; step < 500; step++) {
+		seed = seed * 1103515245 + 12345;
+		const int r = seed >> 8;
+		switch (r % 4) {
+		case 0:
+			pdl->InsertSpace(r % (length + 1), 1 + r % 7);
+			length += 1 + r % 7;
+			break;
+		case 1:
+			if (length > 10) {
+				pdl->DeleteRange(r % (length - 10), 1 + r % 9);
+				length -= 1 + r % 9;
+			}
+			break;
+		default:
+			if (length > 0) {
+				const int position = r % length;
+				Fill((r >> 4) % 8, position, (r >> 8) % 2, 1 + (r >> 12) % (length - position));
+			}
+		}
+		for (int position = 0; position < length; position++) {
+			int mask = 0;
+			for (int indicator = 0; indicator < 8; indicator++) {
+				if (pdl->ValueAt(indicator, position))
+					mask |= 1 << indicator;
+			}
+			ASSERT_EQ(mask, pdl->AllOnFor(position));
+		}
+	}
+}
@@ -197,6 +197,46 @@ TEST_F(PartitioningTest, TestMany) {
 	EXPECT_EQ(11, pp->PartitionFromPosition(50));
 }
 
+TEST_F(PartitioningTest, InsertTextEach) {
+	pp->InsertText(0, 10);
+	for (int i=0; i<9; i++) {
+		pp->InsertPartition(i+1, i+1);
+	}
+	pp->InsertTextEach(2, 3, 2);
+	EXPECT_EQ(10, pp->Partitions());
+	EXPECT_EQ(2, pp->PositionFromPartition(2));
+	EXPECT_EQ(5, pp->PositionFromPartition(3));
+	EXPECT_EQ(8, pp->PositionFromPartition(4));
+	EXPECT_EQ(11, pp->PositionFromPartition(5));
+	EXPECT_EQ(16, pp->PositionFromPartition(10));
+	pp->InsertTextEach(0, 10, -1);
+	EXPECT_EQ(0, pp->PositionFromPartition(1));
+	EXPECT_EQ(2, pp->PositionFromPartition(3));
+	EXPECT_EQ(6, pp->PositionFromPartition(5));
+	EXPECT_EQ(6, pp->PositionFromPartition(10));
+	EXPECT_EQ(3, pp->PartitionFromPosition(3));
+}
+
+TEST_F(PartitioningTest, InsertPartitions) {
+	pp->InsertText(0, 10);
+	const int starts[] = { 2, 5, 7 };
+	pp->InsertPartitions(1, starts, 3);
+	EXPECT_EQ(4, pp->Partitions());
+	EXPECT_EQ(5, pp->PositionFromPartition(2));
+	EXPECT_EQ(10, pp->PositionFromPartition(4));
+	// Inserting after a pending step applies it first
+	pp->InsertText(1, 3);
+	const int startsAfter[] = { 4, 6 };
+	pp->InsertPartitions(2, startsAfter, 2);
+	EXPECT_EQ(6, pp->Partitions());
+	EXPECT_EQ(2, pp->PositionFromPartition(1));
+	EXPECT_EQ(4, pp->PositionFromPartition(2));
+	EXPECT_EQ(6, pp->PositionFromPartition(3));
+	EXPECT_EQ(8, pp->PositionFromPartition(4));
+	EXPECT_EQ(13, pp->PositionFromPartition(6));
+	EXPECT_EQ(3, pp->PartitionFromPosition(7));
+}
+
 #if !PLAT_WIN
 // Omit death tests on Windows where they trigger a system "unitTest.exe has stopped working" popup.
 TEST_F(PartitioningTest, OutOfRangeDeathTest) {
@@ -0,0 +1,448 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+#include <map>
+
+#include "Platform.h"
+
+#include "Scintilla.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+
+#include <gtest/gtest.h>
+
+// Test LineMarkers.
+
+class LineMarkersTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		plm = new LineMarkers();
+	}
+
+	virtual void TearDown() {
+		delete plm;
+		plm = 0;
+	}
+
+	LineMarkers *plm;
+};
+
+TEST_F(LineMarkersTest, IsEmptyInitially) {
+	EXPECT_EQ(0, plm->MarkValue(0));
+	EXPECT_EQ(-1, plm->MarkerNext(0, 0xff));
+	EXPECT_EQ(-1, plm->MarkerPrevious(100, 0xff));
+	EXPECT_EQ(-1, plm->LineFromHandle(1));
+}
+
+TEST_F(LineMarkersTest, AddAndDelete) {
+	int h1 = plm->AddMark(5, 1, 10);
+	int h2 = plm->AddMark(5, 3, 10);
+	EXPECT_NE(h1, h2);
+	EXPECT_EQ(-1, plm->AddMark(10, 1, 10));
+	EXPECT_EQ(0xa, plm->MarkValue(5));
+	EXPECT_EQ(0, plm->MarkValue(4));
+	EXPECT_EQ(5, plm->LineFromHandle(h2));
+	EXPECT_TRUE(plm->DeleteMark(5, 1, false));
+	EXPECT_EQ(0x8, plm->MarkValue(5));
+	EXPECT_EQ(-1, plm->LineFromHandle(h1));
+	plm->DeleteMarkFromHandle(h2);
+	EXPECT_EQ(0, plm->MarkValue(5));
+	EXPECT_EQ(-1, plm->MarkerNext(0, 0xff));
+}
+
+TEST_F(LineMarkersTest, HandlesFollowLines) {
+	int h1 = plm->AddMark(2, 0, 10);
+	int h2 = plm->AddMark(6, 0, 10);
+	plm->InsertLine(4);
+	plm->InsertLine(0);
+	EXPECT_EQ(3, plm->LineFromHandle(h1));
+	EXPECT_EQ(8, plm->LineFromHandle(h2));
+	EXPECT_EQ(1, plm->MarkValue(8));
+	plm->RemoveLine(1);
+	EXPECT_EQ(2, plm->LineFromHandle(h1));
+	EXPECT_EQ(7, plm->LineFromHandle(h2));
+}
+
+TEST_F(LineMarkersTest, InsertLines) {
+	int h1 = plm->AddMark(2, 0, 10);
+	int h2 = plm->AddMark(6, 1, 10);
+	plm->InsertLines(4, 100);
+	plm->InsertLines(2, 3);
+	EXPECT_EQ(5, plm->LineFromHandle(h1));
+	EXPECT_EQ(109, plm->LineFromHandle(h2));
+	EXPECT_EQ(109, plm->MarkerNext(6, 0x2));
+}
+
+TEST_F(LineMarkersTest, RemovedLineMergesIntoPrevious) {
+	int h1 = plm->AddMark(2, 0, 10);
+	int h2 = plm->AddMark(3, 2, 10);
+	int h3 = plm->AddMark(5, 1, 10);
+	plm->RemoveLine(3);
+	EXPECT_EQ(0x5, plm->MarkValue(2));
+	EXPECT_EQ(2, plm->LineFromHandle(h1));
+	EXPECT_EQ(2, plm->LineFromHandle(h2));
+	EXPECT_EQ(4, plm->LineFromHandle(h3));
+	// Moving into an unmarked line
+	plm->RemoveLine(4);
+	EXPECT_EQ(0x2, plm->MarkValue(3));
+	EXPECT_EQ(3, plm->LineFromHandle(h3));
+}
+
+TEST_F(LineMarkersTest, NextAndPrevious) {
+	plm->AddMark(1, 0, 1000);
+	plm->AddMark(500, 1, 1000);
+	plm->AddMark(900, 0, 1000);
+	EXPECT_EQ(1, plm->MarkerNext(0, 0x1));
+	EXPECT_EQ(1, plm->MarkerNext(1, 0x1));
+	EXPECT_EQ(900, plm->MarkerNext(2, 0x1));
+	EXPECT_EQ(500, plm->MarkerNext(2, 0x3));
+	EXPECT_EQ(-1, plm->MarkerNext(2, 0x4));
+	EXPECT_EQ(-1, plm->MarkerNext(901, 0x3));
+	EXPECT_EQ(900, plm->MarkerPrevious(999, 0x1));
+	EXPECT_EQ(500, plm->MarkerPrevious(899, 0x3));
+	EXPECT_EQ(1, plm->MarkerPrevious(499, 0x3));
+	EXPECT_EQ(-1, plm->MarkerPrevious(0, 0x3));
+}
+
+TEST_F(LineMarkersTest, NextSkipsOtherMarkers) {
+	// Many bookmarks and a few breakpoints, changed between searches
+	const int lines = 20000;
+	std::vector<int> marks(lines, 0);
+	for (int line = 0; line < lines; line += 2) {
+		plm->AddMark(line, 1, lines);
+		marks[line] |= 0x2;
+	}
+	unsigned int seed = 1;
+	for (int step = 0; step < 300; step++) {
+		seed = seed * 1103515245 + 12345;
+		const int r = seed >> 8;
+		const int line = r % lines;
+		switch (step % 3) {
+		case 0:
+			plm->AddMark(line, 2, lines);
+			marks[line] |= 0x4;
+			break;
+		case 1:
+			plm->DeleteMark(line, 2, true);
+			marks[line] &= ~0x4;
+			break;
+		default:
+			plm->DeleteMark(line, -1, true);
+			marks[line] = 0;
+			break;
+		}
+		const int start = (r >> 4) % lines;
+		int next = -1;
+		for (int l = start; l < lines; l++) {
+			if (marks[l] & 0x4) {
+				next = l;
+				break;
+			}
+		}
+		EXPECT_EQ(next, plm->MarkerNext(start, 0x4));
+		int previous = -1;
+		for (int l = start; l >= 0; l--) {
+			if (marks[l] & 0x4) {
+				previous = l;
+				break;
+			}
+		}
+		EXPECT_EQ(previous, plm->MarkerPrevious(start, 0x4));
+	}
+}
+
+TEST_F(LineMarkersTest, AddMany) {
+	const int linesAndMarkers[] = { 4, 0, 2, 1, 40, 1, 4, 2 };
+	int handleFirst = plm->AddMarks(4, linesAndMarkers, 10);
+	EXPECT_EQ(0x5, plm->MarkValue(4));
+	EXPECT_EQ(0x2, plm->MarkValue(2));
+	EXPECT_EQ(4, plm->LineFromHandle(handleFirst));
+	EXPECT_EQ(2, plm->LineFromHandle(handleFirst + 1));
+	EXPECT_EQ(-1, plm->LineFromHandle(handleFirst + 2));
+	EXPECT_EQ(4, plm->LineFromHandle(handleFirst + 3));
+	EXPECT_EQ(handleFirst + 4, plm->AddMark(3, 0, 10));
+}
+
+TEST_F(LineMarkersTest, DeleteAll) {
+	plm->AddMark(1, 0, 100);
+	plm->AddMark(2, 1, 100);
+	plm->AddMark(3, 0, 100);
+	EXPECT_FALSE(plm->DeleteAllMarks(2));
+	EXPECT_TRUE(plm->DeleteAllMarks(0));
+	EXPECT_EQ(0, plm->MarkValue(1));
+	EXPECT_EQ(2, plm->MarkValue(2));
+	EXPECT_TRUE(plm->DeleteAllMarks(-1));
+	EXPECT_EQ(-1, plm->MarkerNext(0, -1));
+}
+
+TEST_F(LineMarkersTest, ManyHandles) {
+	// Add in descending order so the positions of earlier sets change
+	const int marks = 1000;
+	int handles[marks];
+	for (int i = marks - 1; i >= 0; i--)
+		handles[i] = plm->AddMark(i * 3, i % 4, marks * 3);
+	for (int i = 0; i < marks; i++)
+		EXPECT_EQ(i * 3, plm->LineFromHandle(handles[i]));
+	plm->InsertLine(0);
+	for (int i = 0; i < marks; i += 2)
+		plm->DeleteMarkFromHandle(handles[i]);
+	for (int i = 1; i < marks; i += 2)
+		EXPECT_EQ(i * 3 + 1, plm->LineFromHandle(handles[i]));
+	EXPECT_EQ(4, plm->MarkerNext(0, 0xf));
+}
+
+// Test LineColumns.
+
+class LineColumnsTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		plc = new LineColumns();
+	}
+
+	virtual void TearDown() {
+		delete plc;
+		plc = 0;
+	}
+
+	LineColumns *plc;
+};
+
+TEST_F(LineColumnsTest, IsBaseInitially) {
+	EXPECT_EQ(SC_FOLDLEVELBASE, plc->GetLevel(0));
+	EXPECT_EQ(3, plc->FirstAtOrBelow(3, 10, SC_FOLDLEVELBASE, false));
+	EXPECT_EQ(-1, plc->FirstAtOrBelow(3, 10, SC_FOLDLEVELBASE, true));
+	EXPECT_EQ(-1, plc->LastAtOrBelow(3, SC_FOLDLEVELBASE - 1, false));
+}
+
+TEST_F(LineColumnsTest, FindAcrossManyLines) {
+	// Far enough apart that the searches use the trees
+	const int lines = 1000;
+	for (int line = 0; line < lines; line++)
+		plc->SetLevel(line, SC_FOLDLEVELBASE + 2, lines);
+	plc->SetLevel(100, (SC_FOLDLEVELBASE + 1) | SC_FOLDLEVELHEADERFLAG, lines);
+	plc->SetLevel(700, SC_FOLDLEVELBASE | SC_FOLDLEVELWHITEFLAG, lines);
+	plc->SetLevel(800, SC_FOLDLEVELBASE + 1, lines);
+	EXPECT_EQ(100, plc->FirstAtOrBelow(0, lines, SC_FOLDLEVELBASE + 1, false));
+	EXPECT_EQ(800, plc->FirstAtOrBelow(101, lines, SC_FOLDLEVELBASE + 1, false));
+	EXPECT_EQ(-1, plc->FirstAtOrBelow(101, 800, SC_FOLDLEVELBASE + 1, false));
+	EXPECT_EQ(-1, plc->FirstAtOrBelow(101, lines, SC_FOLDLEVELNUMBERMASK, true));
+	EXPECT_EQ(100, plc->LastAtOrBelow(900, SC_FOLDLEVELNUMBERMASK, true));
+	EXPECT_EQ(800, plc->LastAtOrBelow(900, SC_FOLDLEVELBASE + 1, false));
+	// Changing a level updates the trees
+	plc->SetLevel(800, SC_FOLDLEVELBASE + 2, lines);
+	EXPECT_EQ(-1, plc->FirstAtOrBelow(101, lines, SC_FOLDLEVELBASE + 1, false));
+	EXPECT_EQ(100, plc->LastAtOrBelow(900, SC_FOLDLEVELBASE + 1, false));
+	// As does inserting and removing lines
+	plc->InsertLine(50);
+	EXPECT_EQ(101, plc->LastAtOrBelow(900, SC_FOLDLEVELNUMBERMASK, true));
+	plc->RemoveLine(10);
+	plc->RemoveLine(10);
+	EXPECT_EQ(99, plc->FirstAtOrBelow(0, lines, SC_FOLDLEVELNUMBERMASK, true));
+}
+
+TEST_F(LineColumnsTest, MatchesScan) {
+	const int lines = 500;
+	unsigned int seed = 1;
+	for (int line = 0; line < lines; line++) {
+		seed = seed * 1103515245 + 12345;
+		const int r = seed >> 8;
+		int level = SC_FOLDLEVELBASE + r % 5;
+		if ((r >> 4) % 4 == 0)
+			level |= SC_FOLDLEVELHEADERFLAG;
+		if ((r >> 6) % 5 == 0)
+			level |= SC_FOLDLEVELWHITEFLAG;
+		plc->SetLevel(line, level, lines);
+	}
+	for (int levelNumber = SC_FOLDLEVELBASE; levelNumber < SC_FOLDLEVELBASE + 5; levelNumber++) {
+		for (int start = 0; start < lines; start += 7) {
+			int first = -1;
+			for (int line = start; line < lines; line++) {
+				const int level = plc->GetLevel(line);
+				if ((level & SC_FOLDLEVELHEADERFLAG) && ((level & SC_FOLDLEVELNUMBERMASK) <= levelNumber)) {
+					first = line;
+					break;
+				}
+			}
+			EXPECT_EQ(first, plc->FirstAtOrBelow(start, lines, levelNumber, true));
+			int last = -1;
+			for (int line = start; line >= 0; line--) {
+				const int level = plc->GetLevel(line);
+				if (!(level & SC_FOLDLEVELWHITEFLAG) && ((level & SC_FOLDLEVELNUMBERMASK) <= levelNumber)) {
+					last = line;
+					break;
+				}
+			}
+			EXPECT_EQ(last, plc->LastAtOrBelow(start, levelNumber, false));
+		}
+	}
+}
+
+TEST_F(LineColumnsTest, MatchesScanWhileEditing) {
+	// Searches after inserting or removing lines scan until they rebuild the trees
+	int lines = 2000;
+	for (int line = 0; line < lines; line++)
+		plc->SetLevel(line, SC_FOLDLEVELBASE + 3, lines);
+	unsigned int seed = 1;
+	for (int edit = 0; edit < 200; edit++) {
+		seed = seed * 1103515245 + 12345;
+		const int r = seed >> 8;
+		const int line = r % lines;
+		if (r & 0x10000) {
+			plc->InsertLine(line);
+			lines++;
+		} else {
+			plc->RemoveLine(line);
+			lines--;
+		}
+		plc->SetLevel(r % lines, SC_FOLDLEVELBASE + r % 3, lines);
+		const int start = (r >> 4) % lines;
+		int first = -1;
+		for (int l = start; l < lines; l++) {
+			if ((plc->GetLevel(l) & SC_FOLDLEVELNUMBERMASK) <= SC_FOLDLEVELBASE + 1) {
+				first = l;
+				break;
+			}
+		}
+		EXPECT_EQ(first, plc->FirstAtOrBelow(start, lines, SC_FOLDLEVELBASE + 1, false));
+		int last = -1;
+		for (int l = start; l >= 0; l--) {
+			if ((plc->GetLevel(l) & SC_FOLDLEVELNUMBERMASK) <= SC_FOLDLEVELBASE + 1) {
+				last = l;
+				break;
+			}
+		}
+		EXPECT_EQ(last, plc->LastAtOrBelow(start, SC_FOLDLEVELBASE + 1, false));
+	}
+}
+
+TEST_F(LineColumnsTest, StatesFollowLines) {
+	EXPECT_EQ(0, plc->GetMaxLineState());
+	EXPECT_EQ(0, plc->SetLineState(3, 7));
+	EXPECT_EQ(4, plc->GetMaxLineState());
+	EXPECT_EQ(7, plc->SetLineState(3, 8));
+	plc->InsertLine(1);
+	EXPECT_EQ(5, plc->GetMaxLineState());
+	EXPECT_EQ(8, plc->GetLineState(4));
+	// Inserting past the states extends them
+	plc->InsertLine(9);
+	EXPECT_EQ(10, plc->GetMaxLineState());
+	plc->RemoveLine(0);
+	EXPECT_EQ(9, plc->GetMaxLineState());
+	EXPECT_EQ(8, plc->GetLineState(3));
+	EXPECT_EQ(0, plc->GetLineState(20));
+	EXPECT_EQ(21, plc->GetMaxLineState());
+}
+
+TEST_F(LineColumnsTest, LevelsAndStatesIndependent) {
+	plc->SetLineState(1, 5);
+	EXPECT_EQ(SC_FOLDLEVELBASE, plc->GetLevel(1));
+	plc->SetLevel(2, SC_FOLDLEVELBASE + 1, 10);
+	EXPECT_EQ(5, plc->GetLineState(1));
+	EXPECT_EQ(2, plc->GetMaxLineState());
+	plc->ClearLevels();
+	EXPECT_EQ(SC_FOLDLEVELBASE, plc->GetLevel(2));
+	EXPECT_EQ(5, plc->GetLineState(1));
+	plc->SetLevel(4, SC_FOLDLEVELBASE | SC_FOLDLEVELHEADERFLAG, 10);
+	plc->SetLevel(5, SC_FOLDLEVELBASE + 1, 10);
+	// Removing a header line moves its flag onto the line before
+	plc->RemoveLine(4);
+	EXPECT_EQ(SC_FOLDLEVELBASE | SC_FOLDLEVELHEADERFLAG, plc->GetLevel(3));
+	EXPECT_EQ(SC_FOLDLEVELBASE + 1, plc->GetLevel(4));
+	EXPECT_EQ(2, plc->GetMaxLineState());
+}
+
+TEST_F(LineColumnsTest, InsertLinesMatchesInsertLine) {
+	LineColumns each;
+	const int lines = 50;
+	for (int line = 0; line < lines; line += 3) {
+		plc->SetLevel(line, SC_FOLDLEVELBASE + line % 4, lines);
+		each.SetLevel(line, SC_FOLDLEVELBASE + line % 4, lines);
+	}
+	plc->SetLineState(20, 2);
+	each.SetLineState(20, 2);
+	const int inserts[] = { 0, 3, 12, 5, 30, 7, 45, 2 };
+	for (size_t i = 0; i < sizeof(inserts) / sizeof(inserts[0]); i += 2) {
+		plc->InsertLines(inserts[i], inserts[i + 1]);
+		for (int n = 0; n < inserts[i + 1]; n++)
+			each.InsertLine(inserts[i]);
+	}
+	EXPECT_EQ(each.GetMaxLineState(), plc->GetMaxLineState());
+	for (int line = 0; line < lines + 17; line++) {
+		EXPECT_EQ(each.GetLevel(line), plc->GetLevel(line));
+		EXPECT_EQ(each.GetLineState(line), plc->GetLineState(line));
+	}
+}
+
+// Test LineAnnotation.
+
+class LineAnnotationTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pla = new LineAnnotation();
+	}
+
+	virtual void TearDown() {
+		delete pla;
+		pla = 0;
+	}
+
+	LineAnnotation *pla;
+};
+
+TEST_F(LineAnnotationTest, IsEmptyInitially) {
+	EXPECT_EQ(0, pla->Length(0));
+	EXPECT_EQ(0, pla->Lines(0));
+	EXPECT_EQ(0, pla->Text(0));
+	EXPECT_EQ(0, pla->Styles(0));
+}
+
+TEST_F(LineAnnotationTest, SetAndClear) {
+	pla->SetText(2, "one\ntwo");
+	pla->SetStyle(2, 5);
+	EXPECT_EQ(7, pla->Length(2));
+	EXPECT_EQ(2, pla->Lines(2));
+	EXPECT_EQ(5, pla->Style(2));
+	EXPECT_EQ(0, memcmp("one\ntwo", pla->Text(2), 7));
+	EXPECT_EQ(0, pla->Text(1));
+	pla->SetText(2, 0);
+	EXPECT_EQ(0, pla->Text(2));
+	EXPECT_EQ(0, pla->Lines(2));
+}
+
+TEST_F(LineAnnotationTest, StylesFollowText) {
+	const unsigned char styles[] = { 1, 2, 3 };
+	pla->SetText(1, "abc");
+	pla->SetStyles(1, styles);
+	EXPECT_TRUE(pla->MultipleStyles(1));
+	EXPECT_EQ(0, memcmp("abc", pla->Text(1), 3));
+	EXPECT_EQ(0, memcmp(styles, pla->Styles(1), 3));
+	pla->InsertLines(0, 3);
+	EXPECT_EQ(0, memcmp(styles, pla->Styles(4), 3));
+	pla->RemoveLine(0);
+	EXPECT_EQ(0, memcmp("abc", pla->Text(3), 3));
+}
+
+TEST_F(LineAnnotationTest, ManyReplacements) {
+	// Replacing annotations repeatedly compacts the arena without disturbing other lines
+	const int lines = 100;
+	for (int line = 0; line < lines; line++)
+		pla->SetText(line, (line % 2) ? "odd\nline" : "even");
+	for (int round = 0; round < 50; round++) {
+		for (int line = 0; line < lines; line += 2)
+			pla->SetText(line, (round % 2) ? "even" : "even\nmore");
+	}
+	for (int line = 0; line < lines; line++) {
+		if (line % 2) {
+			EXPECT_EQ(2, pla->Lines(line));
+			EXPECT_EQ(0, memcmp("odd\nline", pla->Text(line), 8));
+		} else {
+			EXPECT_EQ(1, pla->Lines(line));
+			EXPECT_EQ(0, memcmp("even", pla->Text(line), 4));
+		}
+	}
+}
@@ -0,0 +1,95 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "Platform.h"
+
+#include "PropSetSimple.h"
+
+#include <gtest/gtest.h>
+
+// Test PropSetSimple.
+
+class PropSetSimpleTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pps = new PropSetSimple();
+	}
+
+	virtual void TearDown() {
+		delete pps;
+		pps = 0;
+	}
+
+	PropSetSimple *pps;
+};
+
+TEST_F(PropSetSimpleTest, IsEmptyInitially) {
+	EXPECT_STREQ("", pps->Get("fold"));
+	EXPECT_EQ(0, pps->GetInt("fold"));
+	EXPECT_EQ(3, pps->GetInt("fold", 3));
+}
+
+TEST_F(PropSetSimpleTest, SetAndGet) {
+	pps->Set("fold", "1");
+	pps->Set("fold.compact", "0");
+	EXPECT_STREQ("1", pps->Get("fold"));
+	EXPECT_STREQ("0", pps->Get("fold.compact"));
+	EXPECT_EQ(1, pps->GetInt("fold"));
+	EXPECT_EQ(0, pps->GetInt("fold.compact", 1));
+	pps->Set("fold", "2");
+	EXPECT_STREQ("2", pps->Get("fold"));
+	EXPECT_EQ(2, pps->GetInt("fold"));
+}
+
+TEST_F(PropSetSimpleTest, EmptyValueGivesDefault) {
+	pps->Set("fold.compact", "");
+	EXPECT_STREQ("", pps->Get("fold.compact"));
+	EXPECT_EQ(1, pps->GetInt("fold.compact", 1));
+}
+
+TEST_F(PropSetSimpleTest, KeyLengths) {
+	pps->Set("fold.commentXYZ", "7", 12, 1);
+	EXPECT_STREQ("7", pps->Get("fold.comment"));
+	EXPECT_STREQ("", pps->Get("fold.commentXYZ"));
+	EXPECT_STREQ("", pps->Get("fold"));
+}
+
+TEST_F(PropSetSimpleTest, SetMultiple) {
+	pps->SetMultiple("fold=1\n fold.comment=3\nfold.preprocessor");
+	EXPECT_EQ(1, pps->GetInt("fold"));
+	EXPECT_EQ(3, pps->GetInt("fold.comment"));
+	EXPECT_EQ(1, pps->GetInt("fold.preprocessor"));
+}
+
+TEST_F(PropSetSimpleTest, ManyProperties) {
+	char key[20];
+	char val[20];
+	for (int i = 0; i < 1000; i++) {
+		sprintf(key, "key.%d", i);
+		sprintf(val, "%d", i * 3);
+		pps->Set(key, val);
+	}
+	for (int i = 0; i < 1000; i++) {
+		sprintf(key, "key.%d", i);
+		EXPECT_EQ(i * 3, pps->GetInt(key));
+	}
+	EXPECT_STREQ("", pps->Get("key.1000"));
+}
+
+TEST_F(PropSetSimpleTest, Expansion) {
+	pps->Set("tab", "4");
+	pps->Set("indent", "$(tab)");
+	EXPECT_EQ(4, pps->GetInt("indent"));
+	char result[20];
+	EXPECT_EQ(1, pps->GetExpanded("indent", result));
+	EXPECT_STREQ("4", result);
+	// Setting another property must not leave a stale integer for a dependent property
+	pps->Set("tab", "8");
+	EXPECT_EQ(8, pps->GetInt("indent"));
+	pps->Set("loop", "$(loop)");
+	EXPECT_EQ(5, pps->GetInt("loop", 5));
+}
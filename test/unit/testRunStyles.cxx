@@ -326,3 +326,82 @@ TEST_F(RunStylesTest, OutsideBounds) {
 	EXPECT_EQ(0, prs->StartRun(0));
 	EXPECT_EQ(1, prs->EndRun(0));
 }
+
+TEST_F(RunStylesTest, FillRanges) {
+	prs->InsertSpace(0, 20);
+	const int fills[] = { 2, 3, 1,  5, 2, 1,  10, 5, 2,  18, 2, 3 };
+	EXPECT_EQ(true, prs->FillRanges(4, fills));
+	EXPECT_EQ(20, prs->Length());
+	EXPECT_EQ(6, prs->Runs());
+	EXPECT_EQ(0, prs->ValueAt(1));
+	EXPECT_EQ(2, prs->StartRun(4));
+	EXPECT_EQ(7, prs->EndRun(4));
+	EXPECT_EQ(1, prs->ValueAt(6));
+	EXPECT_EQ(0, prs->ValueAt(7));
+	EXPECT_EQ(2, prs->ValueAt(14));
+	EXPECT_EQ(3, prs->ValueAt(19));
+	prs->Check();
+	// Filling the same again changes nothing
+	EXPECT_EQ(false, prs->FillRanges(4, fills));
+	EXPECT_EQ(6, prs->Runs());
+	prs->Check();
+	// Clearing ranges merges runs
+	const int clears[] = { 0, 10, 0,  10, 10, 0 };
+	EXPECT_EQ(true, prs->FillRanges(2, clears));
+	EXPECT_EQ(1, prs->Runs());
+	prs->Check();
+}
+
+TEST_F(RunStylesTest, FillRangesSkipsInvalid) {
+	prs->InsertSpace(0, 20);
+	// Out of order so filled one at a time, with invalid triples among them
+	const int fills[] = { 10, 5, 2,  -2, 4, 3,  2, 3, 1,  18, 5, 3,  4, -1, 3,  0, 0, 3 };
+	EXPECT_EQ(true, prs->FillRanges(6, fills));
+	EXPECT_EQ(20, prs->Length());
+	EXPECT_EQ(5, prs->Runs());
+	EXPECT_EQ(0, prs->ValueAt(0));
+	EXPECT_EQ(1, prs->ValueAt(4));
+	EXPECT_EQ(2, prs->ValueAt(14));
+	EXPECT_EQ(0, prs->ValueAt(19));
+	prs->Check();
+	const int invalid[] = { 15, 10, 1,  -1, 2, 1 };
+	EXPECT_EQ(false, prs->FillRanges(2, invalid));
+	EXPECT_EQ(5, prs->Runs());
+}
+
+TEST_F(RunStylesTest, FillRangesMatchesFillRange) {
+	RunStyles rsSingle;
+	const int length = 200;
+	prs->InsertSpace(0, length);
+	rsSingle.InsertSpace(0, length);
+	unsigned int seed = 1;
+	for (int pass = 0; pass < 200; pass++) {
+		int fills[30 * 3];
+		int ranges = 0;
+		int position = 0;
+		while (ranges < 30) {
+			seed = seed * 1103515245 + 12345;
+			position += (seed >> 16) % 12;
+			const int fillLength = 1 + (seed >> 8) % 9;
+			if (position + fillLength > length)
+				break;
+			fills[ranges * 3] = position;
+			fills[ranges * 3 + 1] = fillLength;
+			fills[ranges * 3 + 2] = (seed >> 20) % 3;
+			position += fillLength;
+			ranges++;
+		}
+		bool changedSingle = false;
+		for (int range = 0; range < ranges; range++) {
+			int startFill = fills[range * 3];
+			int lengthFill = fills[range * 3 + 1];
+			if (rsSingle.FillRange(startFill, fills[range * 3 + 2], lengthFill))
+				changedSingle = true;
+		}
+		EXPECT_EQ(changedSingle, prs->FillRanges(ranges, fills));
+		prs->Check();
+		EXPECT_EQ(rsSingle.Runs(), prs->Runs());
+		for (int i = 0; i < length; i++)
+			EXPECT_EQ(rsSingle.ValueAt(i), prs->ValueAt(i));
+	}
+}
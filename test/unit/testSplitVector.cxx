@@ -190,6 +190,28 @@ TEST_F(SplitVectorTest, BufferPointer) {
 	}
 }
 
+TEST_F(SplitVectorTest, SegmentPointer) {
+	psv->InsertFromArray(0, testArray, 0, lengthTestArray);
+	psv->Insert(2, 9);	// Leaves the gap after the inserted element
+	const int gap = psv->GapPosition();
+	int start = -1;
+	int end = -1;
+	const int *segment = psv->SegmentPointer(0, start, end);
+	EXPECT_EQ(0, start);
+	EXPECT_EQ(gap, end);
+	for (int i=start; i<end; i++) {
+		EXPECT_EQ(psv->ValueAt(i), segment[i - start]);
+	}
+	segment = psv->SegmentPointer(gap, start, end);
+	EXPECT_EQ(gap, start);
+	EXPECT_EQ(psv->Length(), end);
+	for (int i=start; i<end; i++) {
+		EXPECT_EQ(psv->ValueAt(i), segment[i - start]);
+	}
+	// Retrieving segments does not move the gap
+	EXPECT_EQ(gap, psv->GapPosition());
+}
+
 TEST_F(SplitVectorTest, DeleteBackAndForth) {
 	psv->InsertValue(0, 10, 87);
 	for (int i=0; i<10; i+=2) {
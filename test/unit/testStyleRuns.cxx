@@ -0,0 +1,185 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+
+#include "LexAccessor.h"
+#include "CharacterSet.h"
+#include "StyleRuns.h"
+
+#include <gtest/gtest.h>
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+// A document with text and styles held in two segments split at gap.
+// Only the methods used by LexAccessor for reading are implemented.
+
+class SegmentedDocument : public IDocumentWithSegments {
+	std::string text;
+	std::string styles;
+	int gap;
+	int version;
+	std::vector<int> lineStarts;
+public:
+	SegmentedDocument(const char *text_, const char *styles_, int gap_, int version_) :
+		text(text_), styles(styles_), gap(gap_), version(version_) {
+		lineStarts.push_back(0);
+		for (size_t i = 0; i < text.length(); i++) {
+			if (text[i] == '\n')
+				lineStarts.push_back(static_cast<int>(i + 1));
+		}
+	}
+	virtual ~SegmentedDocument() {
+	}
+	int SCI_METHOD Version() const {
+		return version;
+	}
+	void SCI_METHOD SetErrorStatus(int) {
+	}
+	int SCI_METHOD Length() const {
+		return static_cast<int>(text.length());
+	}
+	void SCI_METHOD GetCharRange(char *buffer, int position, int lengthRetrieve) const {
+		memcpy(buffer, text.c_str() + position, lengthRetrieve);
+	}
+	char SCI_METHOD StyleAt(int position) const {
+		return (position < Length()) ? static_cast<char>(styles[position] - '0') : 0;
+	}
+	int SCI_METHOD LineFromPosition(int position) const {
+		return static_cast<int>(std::upper_bound(lineStarts.begin(), lineStarts.end(), position) - lineStarts.begin()) - 1;
+	}
+	int SCI_METHOD LineStart(int line) const {
+		if (line >= static_cast<int>(lineStarts.size()))
+			return Length();
+		return lineStarts[line];
+	}
+	int SCI_METHOD GetLevel(int) const {
+		return 0;
+	}
+	int SCI_METHOD SetLevel(int, int) {
+		return 0;
+	}
+	int SCI_METHOD GetLineState(int) const {
+		return 0;
+	}
+	int SCI_METHOD SetLineState(int, int) {
+		return 0;
+	}
+	void SCI_METHOD StartStyling(int, char) {
+	}
+	bool SCI_METHOD SetStyleFor(int, char) {
+		return false;
+	}
+	bool SCI_METHOD SetStyles(int, const char *) {
+		return false;
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator(int) {
+	}
+	void SCI_METHOD DecorationFillRange(int, int, int) {
+	}
+	void SCI_METHOD ChangeLexerState(int, int) {
+	}
+	int SCI_METHOD CodePage() const {
+		return 0;
+	}
+	bool SCI_METHOD IsDBCSLeadByte(char) const {
+		return false;
+	}
+	const char * SCI_METHOD BufferPointer() {
+		return text.c_str();
+	}
+	int SCI_METHOD GetLineIndentation(int) {
+		return 0;
+	}
+	int SCI_METHOD LineEnd(int line) const {
+		return LineStart(line + 1) - 1;
+	}
+	int SCI_METHOD GetRelativePosition(int positionStart, int characterOffset) const {
+		return positionStart + characterOffset;
+	}
+	int SCI_METHOD GetCharacterAndWidth(int position, int *pWidth) const {
+		if (pWidth)
+			*pWidth = 1;
+		return static_cast<unsigned char>(text[position]);
+	}
+	const char * SCI_METHOD SegmentPointer(int position, int *segmentStart, int *segmentEnd) const {
+		*segmentStart = (position < gap) ? 0 : gap;
+		*segmentEnd = (position < gap) ? gap : Length();
+		return text.c_str() + *segmentStart;
+	}
+	const char * SCI_METHOD StyleSegmentPointer(int position, int *segmentStart, int *segmentEnd) const {
+		// Style bytes are digits so give a copy with the digit values
+		static std::string values;
+		values = styles;
+		for (size_t i = 0; i < values.length(); i++)
+			values[i] = static_cast<char>(values[i] - '0');
+		*segmentStart = (position < gap) ? 0 : gap;
+		*segmentEnd = (position < gap) ? gap : Length();
+		return values.c_str() + *segmentStart;
+	}
+};
+
+// Describe each run as "start-end:style" with "|" after runs that end their line.
+static std::string Runs(IDocument *pdoc, int startPos, int length, int initStyle) {
+	LexAccessor styler(pdoc);
+	std::string description;
+	char run[100];
+	for (StyleRuns sr(startPos, length, initStyle, styler); sr.More(); sr.Forward()) {
+		sprintf(run, "%d-%d:%d%s%s%s ", sr.Start(), sr.End(), sr.Style(),
+			sr.StartsStyle() ? "<" : "", sr.EndsStyle() ? ">" : "", sr.AtLineEnd() ? "|" : "");
+		description += run;
+	}
+	return description;
+}
+
+static const char text[] =  "ab /*c\n d*/ e\n\nfgh";
+static const char styles[] = "110222202220300444";
+
+class StyleRunsTest : public ::testing::Test {
+};
+
+TEST_F(StyleRunsTest, RunsEndAtStyleChangesAndLineEnds) {
+	SegmentedDocument doc(text, styles, 100, dvOriginal);
+	EXPECT_EQ("0-2:1<> 2-3:0<> 3-7:2<>| 7-8:0<> 8-11:2<> 11-12:0<> 12-13:3<> 13-14:0<| 14-15:0>| 15-18:4<> ",
+		Runs(&doc, 0, doc.Length(), 0));
+}
+
+TEST_F(StyleRunsTest, SegmentBoundaryDoesNotSplitRuns) {
+	for (int gap = 0; gap <= static_cast<int>(strlen(text)); gap++) {
+		SegmentedDocument docSegments(text, styles, gap, dvSegments);
+		SegmentedDocument docOriginal(text, styles, gap, dvOriginal);
+		EXPECT_EQ(Runs(&docOriginal, 0, docOriginal.Length(), 0), Runs(&docSegments, 0, docSegments.Length(), 0));
+	}
+}
+
+TEST_F(StyleRunsTest, PartialRange) {
+	SegmentedDocument doc(text, styles, 5, dvSegments);
+	// Starting inside the comment with initStyle the comment style continues it
+	EXPECT_EQ("4-7:2>| 7-8:0<> 8-10:2< ", Runs(&doc, 4, 6, 2));
+	EXPECT_EQ("", Runs(&doc, 4, 0, 2));
+}
+
+TEST_F(StyleRunsTest, LineVisible) {
+	SegmentedDocument doc("  \n x\n", "000000", 100, dvOriginal);
+	LexAccessor styler(&doc);
+	StyleRuns sr(0, doc.Length(), 0, styler);
+	EXPECT_EQ(0, sr.Line());
+	EXPECT_FALSE(sr.LineVisible());
+	sr.Forward();
+	EXPECT_EQ(1, sr.Line());
+	EXPECT_TRUE(sr.LineVisible());
+	sr.Forward();
+	EXPECT_FALSE(sr.More());
+}
@@ -0,0 +1,84 @@
+// Unit Tests for Scintilla internal data structures
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "Platform.h"
+
+#include "WordList.h"
+
+#include <gtest/gtest.h>
+
+// Test WordList.
+
+class WordListTest : public ::testing::Test {
+protected:
+	virtual void SetUp() {
+		pwl = new WordList();
+	}
+
+	virtual void TearDown() {
+		delete pwl;
+		pwl = 0;
+	}
+
+	WordList *pwl;
+};
+
+TEST_F(WordListTest, IsEmptyInitially) {
+	EXPECT_EQ(0, pwl->Length());
+	EXPECT_FALSE(pwl->InList("struct"));
+}
+
+TEST_F(WordListTest, InList) {
+	pwl->Set("else struct");
+	EXPECT_EQ(2, pwl->Length());
+	EXPECT_TRUE(pwl->InList("struct"));
+	EXPECT_FALSE(pwl->InList("class"));
+	EXPECT_FALSE(pwl->InList("structure"));
+	EXPECT_FALSE(pwl->InList("s"));
+}
+
+TEST_F(WordListTest, Prefix) {
+	pwl->Set("^GTK_ else");
+	EXPECT_TRUE(pwl->InList("GTK_X"));
+	EXPECT_TRUE(pwl->InList("GTK_"));
+	EXPECT_FALSE(pwl->InList("GTK"));
+}
+
+TEST_F(WordListTest, Abbreviated) {
+	pwl->Set("def~ine else");
+	EXPECT_TRUE(pwl->InListAbbreviated("def", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("defin", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("define", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("else", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("de", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("defines", '~'));
+}
+
+// Lists at or above the threshold are hashed and must behave the same as short lists.
+TEST_F(WordListTest, Hashed) {
+	std::string words = "^GTK_ def~ine ";
+	char word[20];
+	for (int i = 0; i < WordList::hashThreshold * 10; i++) {
+		sprintf(word, "api%d ", i);
+		words += word;
+	}
+	pwl->Set(words.c_str());
+	EXPECT_EQ(WordList::hashThreshold * 10 + 2, pwl->Length());
+	for (int i = 0; i < WordList::hashThreshold * 10; i++) {
+		sprintf(word, "api%d", i);
+		EXPECT_TRUE(pwl->InList(word));
+		EXPECT_TRUE(pwl->InListAbbreviated(word, '~'));
+	}
+	EXPECT_FALSE(pwl->InList("api"));
+	EXPECT_FALSE(pwl->InList("api00"));
+	EXPECT_TRUE(pwl->InList("GTK_X"));
+	EXPECT_FALSE(pwl->InList("def"));
+	EXPECT_TRUE(pwl->InList("def~ine"));
+	EXPECT_TRUE(pwl->InListAbbreviated("defi", '~'));
+	EXPECT_TRUE(pwl->InListAbbreviated("GTK_X", '~'));
+	EXPECT_FALSE(pwl->InListAbbreviated("de", '~'));
+}
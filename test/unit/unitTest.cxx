@@ -6,11 +6,12 @@
         Partitioning
         RunStyles
         ContractionState
+        PerLine (LineMarkers)
+        DecorationList
 
     To do:
         Decoration
-        DecorationList
-        PerLine *
+        PerLine (others) *
         CellBuffer *
         Range
         StyledText
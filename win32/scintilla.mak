@@ -263,7 +263,7 @@ $(DIR_O)\ScintillaWinS.obj: ScintillaWin.cxx
 # All lexers depend on this set of headers
 LEX_HEADERS= ..\include\ILexer.h ..\include\Scintilla.h ..\include\SciLexer.h \
  ..\lexlib\Accessor.h ..\lexlib\CharacterSet.h ..\lexlib\LexAccessor.h \
- ..\lexlib\LexerModule.h ..\lexlib\StyleContext.h
+ ..\lexlib\LexerModule.h ..\lexlib\StyleContext.h ..\lexlib\StyleRuns.h
 
 $(DIR_O)\Accessor.obj: ../lexlib/Accessor.cxx ../include/ILexer.h \
   ../include/Scintilla.h ../include/SciLexer.h ../lexlib/PropSetSimple.h \